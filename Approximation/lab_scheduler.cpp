@@ -6,6 +6,16 @@
 #include <iomanip>
 #include <fstream>
 #include <sstream>
+#include <thread>
+#include <cstdio>
+#include <chrono>
+#include <numeric>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
 using namespace std;
 
 
@@ -26,11 +36,34 @@ static std::vector<std::string> split_csv(const std::string& line)
     return out;
 }
 
+// read-only view of an instance's labs in CSR form: the students of lab i
+// are durations[start[i] .. start[i+1]) -- no copies, no size ceiling
+struct LabsView
+{
+    const int* start = nullptr;     // L + 1 offsets into durations
+    const int* durations = nullptr;
+    int L = 0;
+
+    int count(int lab) const { return start[lab + 1] - start[lab]; }
+    const int* students(int lab) const { return durations + start[lab]; }
+};
+
 struct InstanceData
 {
     std::string id;                 // “inst01” …
     int L{} , C{} , T{};            // #labs, #paid-visits, deadline (h)
-    std::vector<std::vector<int>> labs;   // labs[i] = durations (min) of students in lab i
+    std::vector<int> lab_start{0};  // CSR offsets, one per lab row plus the end
+    std::vector<int> durations;     // (min) of all students, lab after lab
+
+    void add_lab(const std::vector<int>& d)
+    {
+        durations.insert(durations.end(), d.begin(), d.end());
+        lab_start.push_back(durations.size());
+    }
+    LabsView labs() const
+    {
+        return {lab_start.data(), durations.data(), (int)lab_start.size() - 1};
+    }
 };
 
 
@@ -40,18 +73,27 @@ struct Student {
 };
 
 struct ScheduleEntry {
-    string student;
+    int student;        // index into the lab's students
     int start;
     int finish;
     int inspection_wait;
 };
 
+// Display name of the i-th student of a lab: Student_A .. Student_Z, then
+// Student_AA, Student_AB, ...  Only built for human-readable output.
+std::string student_name(int i) {
+    std::string letters;
+    for (++i; i > 0; i = (i - 1) / 26)
+        letters.insert(letters.begin(), char('A' + (i - 1) % 26));
+    return "Student_" + letters;
+}
+
 // Generate random students for a lab
 vector<Student> generate_students(int num_students, int min_time, int max_time, mt19937 &rng) {
     vector<Student> students;
     uniform_int_distribution<int> dist(min_time, max_time);
     for (int i = 0; i < num_students; ++i) {
-        string name = "Student_" + string(1, 'A' + i);
+        string name = student_name(i);
         int duration = dist(rng);
         students.push_back({name, duration});
     }
@@ -71,36 +113,77 @@ vector<int> generate_inspection_times(int max_time, int num_students, int num_la
     return times;
 }
 
-// Schedule students in a lab given inspection times
-vector<ScheduleEntry> schedule_lab(const vector<Student> &students, const vector<int> &inspection_times) {
-    vector<ScheduleEntry> schedule;
-    int prev_finish = 0;
-    for (size_t i = 0; i < students.size(); ++i) {
-        int start = (i == 0) ? 0 : schedule.back().finish;
+// Schedule a lab's students, in order, given sorted inspection times.
+// Student i's duration is durations[i]; entries go to out[0 ..), which must
+// have room for n.  Returns how many students got scheduled.  Allocates
+// nothing, so it can run in the hot path with a reused buffer.
+// Start times only grow, so a single cursor walks the calendar alongside the
+// students: one linear merge instead of a binary search per student.
+int schedule_lab(const int durations[], int n, const int inspection_times[], int n_insp,
+                 ScheduleEntry out[]) {
+    int count = 0;
+    int next = 0;                        // first inspection not yet passed
+    for (int i = 0; i < n; ++i) {
+        int start = (i == 0) ? 0 : out[count - 1].finish;
 
-        /* find the first inspection not earlier than start */
-        auto it = std::lower_bound(inspection_times.begin(),
-                                   inspection_times.end(),
-                                   start);
+        /* advance to the first inspection not earlier than start */
+        while (next < n_insp && inspection_times[next] < start) ++next;
 
         /* if no inspection remains, the lab stays dirty → stop scheduling */
-        if (it == inspection_times.end())
+        if (next == n_insp)
             break;                       // exits the student-loop for this lab
 
-        int next_inspection = *it;
+        int next_inspection = inspection_times[next];
         int actual_start    = std::max(start, next_inspection);
 
-        int finish = actual_start + students[i].duration;
-        schedule.push_back({
-            students[i].name,
+        out[count++] = {
+            i,
             actual_start,
-            finish,
+            actual_start + durations[i],
             (i == 0) ? 0 : (actual_start - start)
-        });
+        };
     }
+    return count;
+}
+
+vector<ScheduleEntry> schedule_lab(const vector<Student> &students, const vector<int> &inspection_times) {
+    vector<int> durations;
+    for (const auto &s : students) durations.push_back(s.duration);
+    vector<ScheduleEntry> schedule(students.size());
+    schedule.resize(schedule_lab(durations.data(), durations.size(),
+                                 inspection_times.data(), inspection_times.size(), schedule.data()));
     return schedule;
 }
 
+// Render a lab's schedule as text: | = inspection, X = student, . = idle,
+// one character per time unit from 0 to the last finish, with a space after
+// every 12 units, so the cost is O(last finish); filling whole runs only
+// keeps the loop branch-free.  The saving is that it runs on demand, for
+// --verbose=3 or the one lab --timeline names.  An inspection that falls
+// on an already marked tick is drawn on the next free one.
+std::string render_timeline(const ScheduleEntry schedule[], int n, const vector<int> &inspection_times) {
+    int end = n == 0 ? 0 : schedule[n - 1].finish;
+    std::string cells(end + 1, '.');
+    for (int i = 0; i < n; ++i)
+        if (schedule[i].finish > schedule[i].start)
+            std::fill(cells.begin() + schedule[i].start, cells.begin() + schedule[i].finish, 'X');
+    int mark = -1;
+    for (int t : inspection_times) {
+        mark = std::max(t, mark + 1);
+        if (mark > end) break;
+        cells[mark] = '|';
+    }
+
+    std::string timeline;
+    timeline.reserve(cells.size() + cells.size() / 12);
+    for (size_t t = 0; t < cells.size(); t += 12) {
+        size_t n = std::min<size_t>(12, cells.size() - t);
+        timeline.append(cells, t, n);
+        if (n == 12) timeline += ' ';  // new hour (for long schedules)
+    }
+    return timeline;
+}
+
 // Compute utilization
 void compute_utilization(const vector<ScheduleEntry> &schedule) {
     int total_time = schedule.back().finish - schedule.front().start;
@@ -112,75 +195,578 @@ void compute_utilization(const vector<ScheduleEntry> &schedule) {
     cout << "Total time: " << total_time << " min, Busy: " << busy_time << " min, Utilization: " << std::fixed << std::setprecision(2) << (utilization * 100) << "%\n";
 }
 
+// ----------  tracing ----------
+// Verbosity levels.  TRACE_OFF is the production mode: nothing is formatted
+// at all.  Higher levels emit JSON-lines records: one per lab, then also one
+// per scheduled student, then also every lab's ASCII timeline (a single
+// timeline can be asked for on its own with --timeline).  Records are
+// collected in memory and written in large chunks, never flushed per line.
+enum TraceLevel { TRACE_OFF = 0, TRACE_LABS = 1, TRACE_STUDENTS = 2, TRACE_TIMELINE = 3 };
+
+struct TraceSink
+{
+    int level = TRACE_OFF;
+    std::ostream* out = nullptr;
+    std::string buf;
+    std::string timeline_id;            // --timeline=<instance>:<lab>, lab 1-based
+    int timeline_lab = 0;
+
+    bool active() const { return level > TRACE_OFF || timeline_lab > 0; }
+    bool timeline(const std::string& id, int lab) const
+    {
+        return level >= TRACE_TIMELINE || (lab + 1 == timeline_lab && id == timeline_id);
+    }
+
+    void write(const std::string& records)
+    {
+        buf += records;
+        if (buf.size() >= (1u << 16)) flush();
+    }
+    void flush()
+    {
+        if (out && !buf.empty()) out->write(buf.data(), buf.size());
+        buf.clear();
+    }
+    ~TraceSink() { flush(); }
+};
+
+// builds one JSON object on a single line; closed when it goes out of scope
+struct TraceRecord
+{
+    std::string& out;
+    bool first = true;
+
+    explicit TraceRecord(std::string& o) : out(o) { out += '{'; }
+    ~TraceRecord() { out += "}\n"; }
+
+    TraceRecord& key(const char* k)
+    {
+        out += first ? "\"" : ",\"";
+        out += k;
+        out += "\":";
+        first = false;
+        return *this;
+    }
+    TraceRecord& num(const char* k, long long v) { key(k); out += std::to_string(v); return *this; }
+    TraceRecord& str(const char* k, const std::string& v)
+    {
+        key(k);
+        out += '"';
+        for (unsigned char ch : v) {
+            if (ch == '"' || ch == '\\') { out += '\\'; out += ch; }
+            else if (ch < 0x20 || ch > 0x7e) {
+                char esc[8];
+                snprintf(esc, sizeof esc, "\\u%04x", ch);
+                out += esc;
+            }
+            else out += ch;
+        }
+        out += '"';
+        return *this;
+    }
+    TraceRecord& nums(const char* k, const std::vector<int>& v)
+    {
+        key(k);
+        out += '[';
+        for (size_t i = 0; i < v.size(); ++i) {
+            if (i) out += ',';
+            out += std::to_string(v[i]);
+        }
+        out += ']';
+        return *this;
+    }
+};
+
+// one lab of blackbox, using schedule (room for n_lab entries) as scratch:
+// returns its usage and the number of students it
+// scheduled, and appends its trace records (if level asks for any, or its
+// timeline was requested) to trace
+static void blackbox_lab(const std::string& id, int lab, int n_lab, const int p_lab[],
+                         const std::vector<int>& inspection_times, int level, bool timeline,
+                         std::string& trace, ScheduleEntry schedule[],
+                         int& occupied_out, int& scheduled_out)
+{
+    // Schedule
+    int n = schedule_lab(p_lab, n_lab, inspection_times.data(), inspection_times.size(), schedule);
+    // Occupied/unoccupied
+    int occupied = 0;
+    int unoccupied = 0;
+    for (int i = 0; i < n; ++i) {
+        occupied += (schedule[i].finish - schedule[i].start);
+        if (i > 0) unoccupied += schedule[i].inspection_wait;
+    }
+    occupied_out  = occupied;           // usage of this lab
+    scheduled_out = n;                  // students of this lab
+    if (level < TRACE_LABS && !timeline) return;
+
+    if (level >= TRACE_STUDENTS) {
+        for (int i = 0; i < n; ++i) {
+            const ScheduleEntry& s = schedule[i];
+            TraceRecord(trace).str("instance", id).num("lab", lab + 1).str("student", student_name(s.student))
+                .num("start", s.start).num("finish", s.finish).num("wait", s.inspection_wait);
+        }
+    }
+    int total_time = n == 0 ? 0 : schedule[n - 1].finish - schedule[0].start;
+    if (level >= TRACE_LABS)
+        TraceRecord(trace).str("instance", id).num("lab", lab + 1).nums("inspections", inspection_times)
+            .num("students", n).num("occupied", occupied)
+            .num("idle", unoccupied).num("total", total_time);
+
+    if (timeline)
+        TraceRecord(trace).str("instance", id).num("lab", lab + 1)
+            .str("timeline", render_timeline(schedule, n, inspection_times));
+}
+
+// Persistent worker threads for splitting one instance's labs: started once
+// per workspace and woken for each call, since spawning threads per
+// instance costs more than scheduling a few hundred small labs.
+struct LabPool
+{
+    std::vector<std::thread> workers;
+    std::mutex m;
+    std::condition_variable wake, done;
+    const std::function<void(int, int, int)>* job = nullptr;
+    int n = 0, pending = 0, threads;
+    unsigned generation = 0;
+    bool stop = false;
+
+    explicit LabPool(int t) : threads(t)
+    {
+        for (int w = 1; w < threads; ++w) workers.emplace_back([this, w] { run(w); });
+    }
+    ~LabPool()
+    {
+        { std::lock_guard<std::mutex> g(m); stop = true; }
+        wake.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    int bound(int w) const { return (int)(1LL * n * w / threads); }
+
+    void run(int w)
+    {
+        unsigned seen = 0;
+        std::unique_lock<std::mutex> g(m);
+        for (;;) {
+            wake.wait(g, [&] { return stop || generation != seen; });
+            if (stop) return;
+            seen = generation;
+            g.unlock();
+            (*job)(w, bound(w), bound(w + 1));
+            g.lock();
+            if (--pending == 0) done.notify_one();
+        }
+    }
+
+    // f(chunk, lo, hi) over [0, count), one contiguous chunk per thread
+    void each(int count, const std::function<void(int, int, int)>& f)
+    {
+        {
+            std::lock_guard<std::mutex> g(m);
+            job = &f;
+            n = count;
+            pending = threads - 1;
+            ++generation;
+        }
+        wake.notify_all();
+        f(0, 0, bound(1));
+        std::unique_lock<std::mutex> g(m);
+        done.wait(g, [&] { return pending == 0; });
+    }
+};
+
+// labs from this many up are split across the workspace's pool when it has
+// more than one thread (--threads=N, off by default: the floor is the exact
+// solver's LabPool guess, not yet measured on a multi-core box); each lab's
+// trace records are buffered and written in lab order afterwards
+static const int kParallelLabs = 1024;
+
+// reusable buffers for blackbox: a caller scoring many instances keeps one
+// per thread, and blackbox allocates only when an instance outgrows them
+struct BlackboxWorkspace
+{
+    std::vector<int> inspection_times;
+    std::vector<ScheduleEntry> schedule;
+    std::vector<int> scheduled;
+    std::string records;
+    int threads = 1;                    // lab-level threads, 1 = serial, 0 = one per core
+    std::unique_ptr<LabPool> pool;      // started on the first instance that needs it
+    std::vector<std::vector<ScheduleEntry>> chunk_schedule;  // scratch per pool thread
+};
+
+// blackbox on a given calendar (sorted inspection times, shared by every lab);
+// labs are only split across threads when a workspace is passed in
+void blackbox_on(const std::string& id, const std::vector<int>& inspection_times, const LabsView& labs,
+                 TraceSink& trace, std::vector<int>& usage_out, int& students_out,
+                 BlackboxWorkspace* ws = nullptr)
+{
+    BlackboxWorkspace local;
+    BlackboxWorkspace& w = ws ? *ws : local;
+    const int L = labs.L;
+    std::vector<int>& all_usage = usage_out;    // ← collects each lab’s usage
+    all_usage.assign(L, 0);
+    std::vector<int>& scheduled = w.scheduled;  // ← students scheduled per lab
+    scheduled.assign(L, 0);
+
+    int widest = 0;                             // scratch rows every lab fits in
+    for (int lab = 0; lab < L; ++lab) widest = std::max(widest, labs.count(lab));
+
+    int threads = w.threads > 0 ? w.threads : (int)std::thread::hardware_concurrency();
+    if (L < kParallelLabs || threads < 2) {
+        std::string& records = w.records;
+        if ((int)w.schedule.size() < widest) w.schedule.resize(widest);
+        for (int lab = 0; lab < L; ++lab) {
+            blackbox_lab(id, lab, labs.count(lab), labs.students(lab), inspection_times,
+                         trace.level, trace.timeline(id, lab), records,
+                         w.schedule.data(), all_usage[lab], scheduled[lab]);
+            if (!records.empty()) { trace.write(records); records.clear(); }
+        }
+    } else {
+        if (!w.pool) w.pool.reset(new LabPool(threads));
+        w.chunk_schedule.resize(w.pool->threads);
+        std::vector<std::string> records(trace.active() ? L : 0);
+        std::function<void(int, int, int)> chunk = [&](int c, int lo, int hi) {
+            std::string none;
+            std::vector<ScheduleEntry>& scratch = w.chunk_schedule[c];
+            if ((int)scratch.size() < widest) scratch.resize(widest);
+            for (int lab = lo; lab < hi; ++lab)
+                blackbox_lab(id, lab, labs.count(lab), labs.students(lab), inspection_times,
+                             trace.level, trace.timeline(id, lab), records.empty() ? none : records[lab],
+                             scratch.data(), all_usage[lab], scheduled[lab]);
+        };
+        w.pool->each(L, chunk);
+        for (const auto& r : records) trace.write(r);
+    }
+
+    int total_scheduled = 0;                    // ← counts students actually scheduled
+    for (int k : scheduled) total_scheduled += k;
+    students_out = total_scheduled;
+}
+
 // add two out-params: usage for every lab and total students actually scheduled
-void blackbox(int L, int C, int T, int n[], int p[][100],
-              std::vector<int>& usage_out, int& students_out)
+void blackbox(const std::string& id, int C, int T, const LabsView& labs, TraceSink& trace,
+              std::vector<int>& usage_out, int& students_out, BlackboxWorkspace* ws = nullptr)
 {
-    // n_max is assumed <= 100 for simplicity
-    int n_max = 0;
-    for (int i = 0; i < L; ++i) n_max = max(n_max, n[i]);
+    BlackboxWorkspace local;
+    BlackboxWorkspace& w = ws ? *ws : local;
     int inspection_interval = T / C;        // hours, evenly spaced
-    std::vector<int> all_usage;                 // ← collects each lab’s usage
-    int total_scheduled = 0;                    // ← counts students actually scheduled
+    w.inspection_times.resize(C);
+    for (int c = 0; c < C; ++c) w.inspection_times[c] = c * inspection_interval;
+    blackbox_on(id, w.inspection_times, labs, trace, usage_out, students_out, &w);
+}
+
+// ----------  adaptive inspection placement ----------
+// Even spacing ignores where students actually finish.  The adaptive policy
+// builds two calendars from the finish times themselves and keeps whichever
+// of them (or even spacing) gives the most usage as blackbox counts it, so
+// best_usage is never below even spacing's and idle_time never above.
+
+// blackbox's overall usage under calendar cal, without the per-lab records
+long long calendar_usage(const LabsView& labs, const std::vector<int>& cal)
+{
+    long long used = 0;
+    for (int lab = 0; lab < labs.L; ++lab) {
+        const int* d = labs.students(lab);
+        int t = 0;
+        size_t k = 0;
+        for (int j = 0; j < labs.count(lab); ++j) {
+            while (k < cal.size() && cal[k] < t) ++k;
+            if (k == cal.size()) break;
+            t = cal[k] + d[j];
+            used += d[j];
+        }
+    }
+    return used;
+}
+
+// What the exact solver credits calendar cal with, in its own model: each
+// lab is pruned as pruneInstance does (at most C + 1 students, the last one
+// trimmed so the total fits in T), its first student runs from 0 without a
+// cut, later ones run back to back as long as they finish by the next cut
+// (or T), and after a cut it was idle at, the lab restarts from that cut.
+// Mirrors Optimal's evaluateCuts; the calendar's cut at 0 changes nothing.
+static long long lab_exact_usage(const int d[], int n, const std::vector<int>& cal, int C, int T)
+{
+    if (n == 0) return 0;
+    n = std::min(n, C + 1);
+    long long sum = 0;
+    for (int j = 0; j < n; ++j) sum += d[j];
+    int last = d[n - 1];
+    if (sum > T) last = std::max(1, (int)(last - (sum - T)));
+    auto p = [&](int j) { return j == n - 1 ? last : d[j]; };
+
+    long long u = p(0);
+    int idx = 1, busy = p(0), avail = 0;
+    for (size_t k = 0; k <= cal.size(); ++k) {
+        int cut = k < cal.size() ? cal[k] : T;
+        int t = std::max(avail, busy);
+        while (idx < n && t + p(idx) <= cut) {
+            u += p(idx);
+            t += p(idx);
+            busy = t;
+            idx++;
+        }
+        if (busy <= cut) avail = cut;
+    }
+    return u;
+}
+
+long long exact_usage(const LabsView& labs, const std::vector<int>& cal, int C, int T)
+{
+    long long used = 0;
+    for (int lab = 0; lab < labs.L; ++lab)
+        used += lab_exact_usage(labs.students(lab), labs.count(lab), cal, C, T);
+    return used;
+}
+
+// Upper bound on what the exact solver can reach: a cut never lets a lab
+// run more of its (pruned) students by T than running them back to back
+// with no cut at all, and a calendar shared by every lab can only do worse
+// than each lab on its own, so the per-lab no-cut usages summed bound the
+// exact optimum.  O(N).
+long long usage_bound(const LabsView& labs, int C, int T)
+{
+    static const std::vector<int> no_cuts;
+    return exact_usage(labs, no_cuts, C, T);
+}
+
+// exact_ratio as printed, exact usage / exact upper bound: the fraction of
+// the exact optimum this calendar is guaranteed to reach.  Both sides are in
+// the exact solver's model, not the best_usage column's
+static std::string ratio_text(long long usage, long long bound)
+{
+    char buf[32];
+    snprintf(buf, sizeof buf, "%.4f", bound > 0 ? (double)usage / bound : 1.0);
+    return buf;
+}
+
+// inspection 0 at time 0, the rest at the k/C quantiles of the finish times
+// the students would have run back to back (those before T); O(N log N)
+std::vector<int> quantile_calendar(const LabsView& labs, int C, int T)
+{
+    std::vector<int> finish;
+    for (int lab = 0; lab < labs.L; ++lab) {
+        int t = 0;
+        for (int j = 0; j < labs.count(lab); ++j) {
+            t += labs.students(lab)[j];
+            if (t >= T) break;
+            finish.push_back(t);
+        }
+    }
+    std::sort(finish.begin(), finish.end());
+    std::vector<int> cal{0};
+    for (int k = 1; k < C && !finish.empty(); ++k) {
+        int v = finish[std::min(finish.size() - 1, k * finish.size() / C)];
+        if (v > cal.back()) cal.push_back(v);
+    }
+    return cal;
+}
+
+// density peaks: replays the schedule one inspection at a time and puts the
+// next one at the ready time that releases the most work per unit waited,
+// where the wait is padded by half the time each remaining inspection still
+// has, so an early small peak does not crowd out the rest; O(C L log L)
+std::vector<int> peak_calendar(const LabsView& labs, int C, int T)
+{
+    std::vector<int> next(labs.L, 0), ready(labs.L, 0);
+    std::vector<std::pair<int, int>> events;    // (ready time, next duration)
+    std::vector<int> cal;
+    for (int k = 0; k < C; ++k) {
+        int t = 0;
+        if (k > 0) {
+            events.clear();
+            for (int lab = 0; lab < labs.L; ++lab)
+                if (next[lab] < labs.count(lab) && ready[lab] > cal.back() && ready[lab] < T)
+                    events.push_back({ready[lab], labs.students(lab)[next[lab]]});
+            if (events.empty()) break;
+            std::sort(events.begin(), events.end());
+            const double pad = 0.5 * (T - cal.back()) / (C - k + 1);
+            double best = -1, gain = 0;
+            for (const auto& e : events) {
+                gain += e.second;
+                double score = gain / (e.first - cal.back() + pad);
+                if (score > best) { best = score; t = e.first; }
+            }
+        }
+        cal.push_back(t);
+        for (int lab = 0; lab < labs.L; ++lab)
+            if (next[lab] < labs.count(lab) && ready[lab] <= t)
+                ready[lab] = t + labs.students(lab)[next[lab]++];
+    }
+    return cal;
+}
+
+std::vector<int> adaptive_calendar(const LabsView& labs, int C, int T)
+{
+    std::vector<int> best(C);
+    for (int c = 0; c < C; ++c) best[c] = c * (T / C);
+    long long best_used = calendar_usage(labs, best);
+    for (auto& cal : {quantile_calendar(labs, C, T), peak_calendar(labs, C, T)}) {
+        long long used = calendar_usage(labs, cal);
+        if (used > best_used) { best_used = used; best = cal; }
+    }
+    return best;
+}
 
-    for (int lab = 0; lab < L; ++lab) {
-        cout << "\n--- Lab_" << (lab+1) << " ---\n";
-        // Build students vector
-        vector<Student> students;
-        for (int j = 0; j < n[lab]; ++j) {
-            string name = "Student_" + string(1, 'A' + j);
-            students.push_back({name, p[lab][j]});
+// ----------  multi-start randomized placement ----------
+// Best of N calendars: start 0 is the adaptive calendar, the others are
+// random perturbations of it, alternating between even spacing with each
+// inspection jittered by up to half an interval and C - 1 finish times drawn
+// at random from the back-to-back finish times.  Start s draws from its own
+// small generator seeded from (seed, s), so the result depends on the seed,
+// never on how the starts were split across threads.  Candidates are scored
+// with calendar_usage, the usage the CSV reports, so the result is never
+// below the adaptive calendar's.  Starts run on pool's threads if given.
+std::vector<int> multistart_calendar(const LabsView& labs, int C, int T, int starts,
+                                     unsigned seed, LabPool* pool = nullptr)
+{
+    std::vector<int> finish;                    // back-to-back finish times before T
+    for (int lab = 0; lab < labs.L; ++lab) {
+        int t = 0;
+        for (int j = 0; j < labs.count(lab); ++j) {
+            t += labs.students(lab)[j];
+            if (t >= T) break;
+            finish.push_back(t);
         }
-        // Inspection times for this lab
-        vector<int> inspection_times;
-        for (int c = 0; c < C; ++c) {
-            inspection_times.push_back(c * inspection_interval);
+    }
+    const int d = T / C;
+    auto perturbed = [&](int s, std::vector<int>& cal) {
+        std::minstd_rand rng(seed * 2654435761u + (unsigned)s * 40503u + 1u);
+        cal.assign(1, 0);
+        if (s % 2 == 1 || finish.empty()) {
+            uniform_int_distribution<int> jitter(-d / 2, d / 2);
+            for (int c = 1; c < C; ++c) cal.push_back(std::min(T - 1, std::max(1, c * d + jitter(rng))));
+        } else {
+            uniform_int_distribution<int> pick(0, (int)finish.size() - 1);
+            for (int c = 1; c < C; ++c) cal.push_back(finish[pick(rng)]);
         }
-        // Output inspection times
-        cout << "Inspection times (min): ";
-        for (auto t : inspection_times) cout << t << " ";
-        cout << "\n";
-        // Schedule
-        auto schedule = schedule_lab(students, inspection_times);
-        // Output schedule (in hours)
-        for (const auto &s : schedule) {
-            cout << s.student << ": Start " << s.start << " h, Finish " << s.finish << " h, Inspection wait: " << s.inspection_wait << " h\n";
+        std::sort(cal.begin(), cal.end());
+        cal.erase(std::unique(cal.begin(), cal.end()), cal.end());
+    };
+
+    std::vector<int> best = adaptive_calendar(labs, C, T);
+    long long best_used = calendar_usage(labs, best);
+    const int threads = pool ? pool->threads : 1;
+    std::vector<std::vector<int>> part_best(threads);
+    std::vector<long long> part_used(threads, -1);
+    std::vector<int> part_start(threads, 0);
+    std::function<void(int, int, int)> chunk = [&](int w, int lo, int hi) {
+        std::vector<int> cal;
+        for (int s = 1 + lo; s < 1 + hi; ++s) {
+            perturbed(s, cal);
+            long long used = calendar_usage(labs, cal);
+            if (used > part_used[w]) { part_used[w] = used; part_best[w] = cal; part_start[w] = s; }
         }
-        // Occupied/unoccupied
-        int occupied = 0;
-        int unoccupied = 0;
-        for (size_t i = 0; i < schedule.size(); ++i) {
-            occupied += (schedule[i].finish - schedule[i].start);
-            if (i > 0) unoccupied += schedule[i].inspection_wait;
+    };
+    if (pool) pool->each(starts - 1, chunk);
+    else chunk(0, 0, starts - 1);
+    int best_start = 0;
+    for (int w = 0; w < threads; ++w)      // ties go to the lowest start, whatever the split
+        if (part_used[w] > best_used || (part_used[w] == best_used && part_start[w] < best_start)) {
+            best_used = part_used[w];
+            best = part_best[w];
+            best_start = part_start[w];
         }
-        int total_time = schedule.back().finish - schedule.front().start;
-        cout << "Occupied time: " << occupied << " h\n";
-        cout << "Unoccupied (idle) time: " << unoccupied << " h\n";
-        cout << "Total time: " << total_time << " h\n";
-        // Visual timeline (in hours)
-        cout << "Timeline (| = inspection, [X] = student):\n ";
-        int time = 0, idx = 0, next_insp = 0;
-        for (int t = 0; t <= schedule.back().finish; t += 1) {
-            bool is_insp = (next_insp < (int)inspection_times.size() && t >= inspection_times[next_insp]);
-            bool is_stud = (idx < (int)schedule.size() && t >= schedule[idx].start && t < schedule[idx].finish);
-            if (is_insp) {
-                cout << "|";
-                next_insp++;
-            } else if (is_stud) {
-                cout << "X";
-            } else {
-                cout << ".";
+    return best;
+}
+
+// ----------  batch approximation (structure of arrays) ----------
+// Many instances packed into flat arrays so the even-spacing policy can be
+// scored for all of them in one pass: per-instance scalars side by side,
+// labs of every instance in one CSR table, students in one duration array.
+// Instance i owns labs [lab_begin[i], lab_begin[i+1]); lab j owns students
+// durations[lab_start[j] .. lab_start[j+1]).
+struct InstanceBatch
+{
+    std::vector<int> L, C, T;
+    std::vector<int> lab_begin{0};
+    std::vector<int> lab_start{0};
+    std::vector<int> durations;
+
+    int size() const { return (int)L.size(); }
+    void add(const InstanceData& inst)
+    {
+        L.push_back(inst.L);
+        C.push_back(inst.C);
+        T.push_back(inst.T);
+        const int base = durations.size();
+        durations.insert(durations.end(), inst.durations.begin(), inst.durations.end());
+        for (size_t j = 1; j < inst.lab_start.size(); ++j) lab_start.push_back(base + inst.lab_start[j]);
+        lab_begin.push_back(lab_start.size() - 1);
+    }
+};
+
+// per-instance results of approximate_batch, same meaning as the CSV columns;
+// exact and bound are only filled by exact_batch
+struct BatchResult
+{
+    std::vector<long long> usage;
+    std::vector<long long> idle;
+    std::vector<long long> exact;       // exact_usage of the even calendar
+    std::vector<long long> bound;       // usage_bound, the exact_upper_bound column
+    std::vector<int> students;
+};
+
+// Even spacing for every instance of the batch.  Same schedule as blackbox,
+// but with no calendar and no per-student records: inspection k sits at
+// k * (T / C), and the cursor over it is a running multiple, so each lab is
+// one branch-light loop over a contiguous run of durations.
+void approximate_batch(const InstanceBatch& b, BatchResult& r)
+{
+    const int n = b.size();
+    r.usage.assign(n, 0);
+    r.idle.assign(n, 0);
+    r.students.assign(n, 0);
+    const int* start = b.lab_start.data();
+    const int* dur = b.durations.data();
+
+    for (int i = 0; i < n; ++i) {
+        const int d = b.T[i] / b.C[i];
+        const long long last = 1LL * (b.C[i] - 1) * d;  // last inspection time
+        long long used = 0;
+        int counted = 0;
+        for (int lab = b.lab_begin[i]; lab < b.lab_begin[i + 1]; ++lab) {
+            long long t = 0, insp = 0;                   // lab free at t; next inspection >= t
+            int j = start[lab];
+            const int end = start[lab + 1];
+            for (; j < end; ++j) {
+                while (insp < t && insp <= last) insp += d ? d : last + 1;
+                if (insp > last) break;                  // no inspection left: lab stays dirty
+                t = insp + dur[j];
+                used += dur[j];
             }
-            if ((t) % 12 == 11) cout << " "; // new hour (for long schedules)
-            if (idx < (int)schedule.size() && t >= schedule[idx].finish) idx++;
+            counted += j - start[lab];
         }
-        cout << "\n";
-        all_usage.push_back(occupied);          // track usage of this lab   (← occupied *is* defined)
-        total_scheduled += schedule.size();     // add students of this lab
+        long long idle = 1LL * b.T[i] * b.L[i] - used;
+        r.usage[i] = used;
+        r.idle[i] = idle < 0 ? 0 : idle;
+        r.students[i] = counted;
+    }
+}
+
+// The exact-model columns for the even calendar, as a pass of their own so
+// --bench-batch times the scheduling loop alone: two lab_exact_usage walks
+// per lab cost more than the schedule itself.
+void exact_batch(const InstanceBatch& b, BatchResult& r)
+{
+    const int n = b.size();
+    r.exact.assign(n, 0);
+    r.bound.assign(n, 0);
+    std::vector<int> cal;
+    static const std::vector<int> no_cuts;
+    const int* start = b.lab_start.data();
+    const int* dur = b.durations.data();
 
+    for (int i = 0; i < n; ++i) {
+        cal.resize(b.C[i]);
+        for (int c = 0; c < b.C[i]; ++c) cal[c] = c * (b.T[i] / b.C[i]);
+        for (int lab = b.lab_begin[i]; lab < b.lab_begin[i + 1]; ++lab) {
+            const int* d = dur + start[lab];
+            const int count = start[lab + 1] - start[lab];
+            r.exact[i] += lab_exact_usage(d, count, cal, b.C[i], b.T[i]);
+            r.bound[i] += lab_exact_usage(d, count, no_cuts, b.C[i], b.T[i]);
+        }
     }
-    usage_out   = all_usage;
-    students_out = total_scheduled;
 }
 
 
@@ -190,18 +776,65 @@ int main(int argc, char* argv[]) {
     // Default file paths
     string inpath = "500_tight_instances.csv";
     string outpath = "500_tight_instancesOutputApprox.csv";
+    std::ofstream tracefile;            // declared first: trace flushes into it on exit
+    TraceSink trace;                    // silent unless --verbose asks for records
+    string tracepath;                   // empty -> records go to stdout
+    bool batch = false;                 // --batch: score everything with approximate_batch
+    int bench_batch = 0;                // --bench-batch=N: time N passes of it, then exit
+    int jobs = (int)std::thread::hardware_concurrency();  // --jobs=N: instances scored in parallel
+    int threads = 1;                    // --threads=N: split one instance's labs / starts, 0 = one per core
+    string policy = "even";             // --policy=even|adaptive|multistart
+    int starts = 64;                    // --starts=N: calendars tried by multistart
+    unsigned seed = 1;                  // --seed=S: multistart's random stream
+    bool bench_multistart = false;      // --bench-multistart: quality per ms, then exit
+    string comparepath;                 // --compare=exact.csv: report the gap to the exact solver
 
     // Check for command-line arguments
-    if (argc == 3) {
-        inpath = argv[1];
-        outpath = argv[2];
-        cout << "Using input file: " << inpath << endl;
-        cout << "Using output file: " << outpath << endl;
-    } else if (argc != 1) { // argc == 1 means no arguments, use defaults
-        cerr << "Usage: " << argv[0] << " <input_csv_path> <output_csv_path>" << endl;
+    vector<string> files;
+    for (int a = 1; a < argc; ++a) {
+        string arg = argv[a];
+        if (arg.rfind("--verbose=", 0) == 0) trace.level = std::stoi(arg.substr(10));
+        else if (arg == "-v") trace.level = std::min(trace.level + 1, (int)TRACE_TIMELINE);
+        else if (arg.rfind("--trace=", 0) == 0) tracepath = arg.substr(8);
+        else if (arg.rfind("--timeline=", 0) == 0 && arg.find(':') != string::npos) {
+            size_t colon = arg.rfind(':');
+            trace.timeline_id = arg.substr(11, colon - 11);
+            trace.timeline_lab = std::stoi(arg.substr(colon + 1));
+        }
+        else if (arg == "--batch") batch = true;
+        else if (arg.rfind("--jobs=", 0) == 0) jobs = std::stoi(arg.substr(7));
+        else if (arg.rfind("--threads=", 0) == 0) threads = std::stoi(arg.substr(10));
+        else if (arg == "--policy=even" || arg == "--policy=adaptive" || arg == "--policy=multistart")
+            policy = arg.substr(9);
+        else if (arg.rfind("--starts=", 0) == 0) starts = std::max(1, std::stoi(arg.substr(9)));
+        else if (arg.rfind("--seed=", 0) == 0) seed = std::stoul(arg.substr(7));
+        else if (arg == "--bench-multistart") bench_multistart = true;
+        else if (arg.rfind("--compare=", 0) == 0) comparepath = arg.substr(10);
+        else if (arg.rfind("--bench-batch=", 0) == 0) bench_batch = std::stoi(arg.substr(14));
+        else files.push_back(arg);
+    }
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    if (files.size() == 2) {
+        inpath = files[0];
+        outpath = files[1];
+        cout << "Using input file: " << inpath << '\n';
+        cout << "Using output file: " << outpath << '\n';
+    } else if (!files.empty()) { // no file arguments means use defaults
+        cerr << "Usage: " << argv[0] << " [<input_csv_path> <output_csv_path>]"
+                " [--verbose=0..3 | -v ...] [--trace=path] [--timeline=<instance>:<lab>]"
+                " [--batch] [--bench-batch=N] [--jobs=N] [--threads=N] [--compare=exact.csv]"
+                " [--policy=even|adaptive|multistart] [--starts=N] [--seed=S] [--bench-multistart]" << endl;
         cerr << "Or run without arguments to use default paths: input/lab_scheduler_input.csv and output/lab_scheduler_output.csv" << endl;
+        cerr << "Verbosity: 0 silent (default), 1 one JSON record per lab, 2 also per student, 3 also timelines" << endl;
         return 1; // Indicate an error
     }
+    if (trace.active()) {
+        if (!tracepath.empty()) {
+            tracefile.open(tracepath);
+            if (!tracefile) { std::cerr << "Cannot open " << tracepath << '\n'; return 1; }
+            trace.out = &tracefile;
+        } else trace.out = &cout;
+    }
 
     // ----------  read NEW csv format  ----------
     std::ifstream infile(inpath);
@@ -236,7 +869,7 @@ int main(int argc, char* argv[]) {
             std::vector<int> durations;
             durations.reserve(nStu);
             for (int k = 0; k < nStu; ++k) durations.push_back(std::stoi(f[2 + k]));
-            instances.back().labs.push_back(std::move(durations));
+            instances.back().add_lab(durations);
         }
     }
 
@@ -246,41 +879,156 @@ int main(int argc, char* argv[]) {
 
     // STEP 5: Output to CSV (inspection_times in hours)
     // ----------  schedule each instance & write summary  ----------
-    std::ofstream outfile(outpath);
-    outfile << "instance_id,best_usage,idle_time,labs,counted_students\n";
-
-    for (const auto& inst : instances)
-    {
-        /*  build the fixed-size arrays blackbox expects  */
-        int n[100] = {0};
-        int p[100][100] = {0};
-        for (size_t i = 0; i < inst.labs.size(); ++i) {
-            n[i] = inst.labs[i].size();
-            for (size_t j = 0; j < inst.labs[i].size(); ++j)
-                p[i][j] = inst.labs[i][j];
+    if (bench_multistart) {
+        // even spacing (what blackbox does) against multistart at growing N,
+        // all on the usage the CSV reports
+        std::unique_ptr<LabPool> pool(threads > 1 ? new LabPool(threads) : nullptr);
+        auto timed = [&](int n) {
+            long long used = 0;
+            auto t0 = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < instances.size(); ++i) {
+                const auto& inst = instances[i];
+                std::vector<int> cal(inst.C);
+                for (int c = 0; c < inst.C; ++c) cal[c] = c * (inst.T / inst.C);
+                if (n > 0) cal = multistart_calendar(inst.labs(), inst.C, inst.T, n, seed + i, pool.get());
+                used += calendar_usage(inst.labs(), cal);
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            return std::make_pair(used, ms);
+        };
+        auto base = timed(0);
+        cout << "starts,usage,ms,gain_per_extra_ms\n" << "even," << base.first << ','
+             << std::fixed << std::setprecision(2) << base.second << ",\n";
+        for (int n : {1, 4, 16, 64, 256}) {
+            auto r = timed(n);
+            cout << n << ',' << r.first << ',' << r.second << ','
+                 << (r.first - base.first) / std::max(1e-3, r.second - base.second) << '\n';
+        }
+        return 0;
+    }
+    if ((batch || bench_batch > 0) && policy != "even") {
+        std::cerr << "--batch and --bench-batch score the even policy only\n";
+        return 1;
+    }
+    if (batch || bench_batch > 0) {
+        InstanceBatch packed;
+        for (const auto& inst : instances) packed.add(inst);
+        BatchResult res;
+        if (bench_batch > 0) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (int rep = 0; rep < bench_batch; ++rep) approximate_batch(packed, res);
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            double students = 1.0 * packed.durations.size() * bench_batch;
+            cout << "batch: " << bench_batch << " x " << packed.size() << " instances, "
+                 << std::fixed << std::setprecision(3) << s << " s, "
+                 << std::setprecision(1) << students / s / 1e6 << " M students/s\n";
+            return 0;
         }
+        approximate_batch(packed, res);
+        exact_batch(packed, res);
+        std::ofstream outfile(outpath);
+        outfile << "instance_id,best_usage,idle_time,labs,counted_students,exact_usage,exact_upper_bound,exact_ratio\n";
+        for (int i = 0; i < packed.size(); ++i)
+            outfile << instances[i].id << ',' << res.usage[i] << ',' << res.idle[i] << ','
+                    << packed.L[i] << ',' << res.students[i] << ',' << res.exact[i] << ','
+                    << res.bound[i] << ',' << ratio_text(res.exact[i], res.bound[i]) << '\n';
+        return 0;
+    }
 
+    // Instances are independent: workers pull blocks of them off a shared
+    // counter, each with its own workspace, and format their rows into
+    // rows[i]; the rows are then written in input order.  With more than one
+    // job a single instance is not split across labs as well, so a run with
+    // fewer instances than jobs keeps one job and, with --threads=N, lets
+    // blackbox split labs.
+    // Tracing keeps one job so its records stay in order.
+    if (trace.active() || instances.size() < (size_t)jobs) jobs = 1;
+    std::vector<std::string> rows(instances.size());
+    std::vector<long long> credited(comparepath.empty() ? 0 : instances.size());
+    std::atomic<size_t> next_instance{0};
+    const size_t block = 16;
+    auto work = [&]() {
+        BlackboxWorkspace ws;
+        ws.threads = jobs > 1 ? 1 : threads;
+        if (policy == "multistart" && jobs == 1 && threads > 1) ws.pool.reset(new LabPool(threads));
         std::vector<int> usage_per_lab;
-        int counted_students = 0;
-        blackbox(inst.L, inst.C, inst.T, n, p, usage_per_lab, counted_students);
+        std::vector<int> calendar;
+        for (;;) {
+            size_t lo = next_instance.fetch_add(block);
+            if (lo >= instances.size()) break;
+            size_t hi = std::min(instances.size(), lo + block);
+            for (size_t i = lo; i < hi; ++i) {
+                const auto& inst = instances[i];
+                int counted_students = 0;
+                if (policy != "even") {
+                    calendar = policy == "adaptive"
+                             ? adaptive_calendar(inst.labs(), inst.C, inst.T)
+                             : multistart_calendar(inst.labs(), inst.C, inst.T, starts, seed + i, ws.pool.get());
+                    blackbox_on(inst.id, calendar, inst.labs(), trace, usage_per_lab, counted_students, &ws);
+                } else {
+                    blackbox(inst.id, inst.C, inst.T, inst.labs(), trace, usage_per_lab, counted_students, &ws);
+                }
 
-        /*  derive the summary numbers the new format wants  */
-        int overall_usage = std::accumulate(usage_per_lab.begin(),
-                                    usage_per_lab.end(), 0);
+                /*  derive the summary numbers the new format wants  */
+                int overall_usage = std::accumulate(usage_per_lab.begin(),
+                                            usage_per_lab.end(), 0);
 
-        /* Total available time is T hours per lab */
-        long long facility_time = 1LL * inst.T * inst.L;
-        long long idle_time     = facility_time - overall_usage;
-        if (idle_time < 0) idle_time = 0;   // guard against rounding / overshoot
+                /* Total available time is T hours per lab */
+                long long facility_time = 1LL * inst.T * inst.L;
+                long long idle_time     = facility_time - overall_usage;
+                if (idle_time < 0) idle_time = 0;   // guard against rounding / overshoot
 
+                /* what the exact solver would credit this calendar with, and the
+                   most an exact solve could reach */
+                const auto& cal = policy != "even" ? calendar : ws.inspection_times;
+                long long exact = exact_usage(inst.labs(), cal, inst.C, inst.T);
+                long long bound = usage_bound(inst.labs(), inst.C, inst.T);
+                if (!credited.empty()) credited[i] = exact;
+                rows[i] = inst.id + ',' + std::to_string(overall_usage) + ',' + std::to_string(idle_time)
+                        + ',' + std::to_string(inst.L) + ',' + std::to_string(counted_students)
+                        + ',' + std::to_string(exact) + ',' + std::to_string(bound)
+                        + ',' + ratio_text(exact, bound) + '\n';
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int j = 1; j < jobs; ++j) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
 
-        outfile << inst.id << ','
-        << overall_usage   << ','
-        << idle_time       << ','
-        << inst.L          << ','
-        << counted_students << '\n';
+    std::ofstream outfile(outpath);
+    outfile << "instance_id,best_usage,idle_time,labs,counted_students,exact_usage,exact_upper_bound,exact_ratio\n";
+    for (const auto& row : rows) outfile << row;
+    outfile.close();
 
+    // ----------  gap to the exact solver  ----------
+    // The CSV's best_usage is counted in this program's model; the exact
+    // solver's best_usage is not, so the gap scores the chosen calendar with
+    // exact_usage, the exact solver's own objective.
+    if (!comparepath.empty()) {
+        std::ifstream exact(comparepath);
+        if (!exact) { std::cerr << "Cannot open " << comparepath << '\n'; return 1; }
+        std::map<std::string, long long> best;
+        std::getline(exact, line);                 // header
+        while (std::getline(exact, line)) {
+            auto f = split_csv(line);
+            if (f.size() >= 2 && !f[0].empty()) best[f[0]] = std::stoll(f[1]);
+        }
+        std::vector<double> gaps;
+        long long ours = 0, theirs = 0;
+        for (size_t i = 0; i < instances.size(); ++i) {
+            auto it = best.find(instances[i].id);
+            if (it == best.end() || it->second <= 0) continue;
+            ours += credited[i];
+            theirs += it->second;
+            gaps.push_back(100.0 * (it->second - credited[i]) / it->second);
+        }
+        if (gaps.empty()) { std::cerr << "No instance of " << comparepath << " matches the input\n"; return 1; }
+        std::sort(gaps.begin(), gaps.end());
+        double mean = std::accumulate(gaps.begin(), gaps.end(), 0.0) / gaps.size();
+        cout << policy << " vs exact on " << gaps.size() << " instances: usage "
+             << ours << " / " << theirs << ", gap mean " << std::fixed << std::setprecision(2) << mean
+             << "%, median " << gaps[gaps.size() / 2] << "%, max " << gaps.back() << "%\n";
     }
-    outfile.close();
     return 0;
 }
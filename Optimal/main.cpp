@@ -4,12 +4,18 @@ using namespace std;
 /* ---------- Data types ---------- */
 struct Lab {
     vector<int> p;           // processing times
+    int mult = 1;            // identical labs folded into this one by presolve
 };
 
 struct Instance {
     string id;
     int L, C, T;
-    vector<Lab> labs;        // size == L after parsing
+    vector<Lab> labs;        // size == L after parsing (fewer after presolve)
+
+    /* filled in by presolveInstance() */
+    bool presolved = false;
+    vector<int> finishTimes; // candidate inspection times, sorted, < T
+    long long fixedUsage = 0;// usage of labs removed because cuts cannot change it
 };
 
 /* ---------- CSV helpers ---------- */
@@ -48,172 +54,2418 @@ void pruneInstance(Instance& ins) {
             if (lab.p.back() < 1) lab.p.back() = 1; // never 0/negative
         }
     }
-}/* ---------- Helper DFS with *working* branch-and-bound ---------- */
+}
+
+/* ---------- Candidate inspection times ---------- */
+vector<int> buildFinishTimes(const Instance& ins)
+{
+    vector<int> finishTimes;
+    for (const Lab& lab : ins.labs)
+    {
+        int t = 0;
+        for (int j = 0; j < (int)lab.p.size() && j <= ins.C; ++j)
+        {
+            t += lab.p[j];
+            if (t < ins.T) finishTimes.push_back(t);
+        }
+    }
+    sort(finishTimes.begin(), finishTimes.end());
+    finishTimes.erase(unique(finishTimes.begin(), finishTimes.end()),
+                      finishTimes.end());
+    return finishTimes;
+}
+
+/* ---------- PRESOLVE ----------
+   Exact reductions applied after pruneInstance.  The candidate set is taken
+   from the labs *before* any rule runs, so removing a lab never removes a cut
+   the other labs could have used.  Every rule returns how much it removed.  */
+struct PresolveRule {
+    const char* name;
+    long long (*apply)(Instance&);
+};
+
+/* a student whose earliest possible finish is past T is never counted;
+   student 0 is always counted, so only j >= 1 is dropped */
+long long presolveLateStudents(Instance& ins)
+{
+    long long dropped = 0;
+    for (Lab& lab : ins.labs) {
+        long long t = lab.p.empty() ? 0 : lab.p[0];
+        for (int j = 1; j < (int)lab.p.size(); ++j) {
+            t += lab.p[j];
+            if (t > ins.T) {
+                dropped += lab.p.size() - j;
+                lab.p.resize(j);
+                break;
+            }
+        }
+    }
+    return dropped;
+}
+
+/* a lab with at most one student contributes p[0] whatever the cuts are */
+long long presolveFixedLabs(Instance& ins)
+{
+    long long fixed = 0;
+    vector<Lab> keep;
+    for (Lab& lab : ins.labs) {
+        if (lab.p.size() <= 1) {
+            ins.fixedUsage += 1LL * lab.mult * (lab.p.empty() ? 0 : lab.p[0]);
+            fixed += lab.mult;
+        } else {
+            keep.push_back(move(lab));
+        }
+    }
+    ins.labs = move(keep);
+    return fixed;
+}
+
+/* labs with identical periods follow identical schedules: keep one, weighted */
+long long presolveMergeLabs(Instance& ins)
+{
+    long long before = ins.labs.size();
+    sort(ins.labs.begin(), ins.labs.end(),
+         [](const Lab& a, const Lab& b) { return a.p < b.p; });
+    vector<Lab> keep;
+    for (Lab& lab : ins.labs) {
+        if (!keep.empty() && keep.back().p == lab.p) keep.back().mult += lab.mult;
+        else keep.push_back(move(lab));
+    }
+    ins.labs = move(keep);
+    return before - (long long)ins.labs.size();
+}
+
+/* a cut earlier than every lab's first finish changes no state, so all such
+   cuts are interchangeable: only the first C of them are worth keeping */
+long long presolveFinishTimes(Instance& ins)
+{
+    int firstFinish = ins.T;
+    for (const Lab& lab : ins.labs)
+        if (!lab.p.empty()) firstFinish = min(firstFinish, lab.p[0]);
+
+    auto& ft = ins.finishTimes;
+    long long before = ft.size();
+    int inert = lower_bound(ft.begin(), ft.end(), firstFinish) - ft.begin();
+    if (inert > ins.C) ft.erase(ft.begin() + ins.C, ft.begin() + inert);
+    return before - (long long)ft.size();
+}
+
+const vector<PresolveRule>& defaultPresolveRules()
+{
+    static const vector<PresolveRule> rules = {
+        {"late-students", presolveLateStudents},
+        {"fixed-labs",    presolveFixedLabs},
+        {"merge-labs",    presolveMergeLabs},
+        {"finish-times",  presolveFinishTimes},
+    };
+    return rules;
+}
+
+/* runs every rule once; reduced[k] is what rule k removed */
+vector<long long> presolveInstance(Instance& ins,
+                                   const vector<PresolveRule>& rules = defaultPresolveRules())
+{
+    ins.finishTimes = buildFinishTimes(ins);
+    ins.presolved   = true;
+
+    vector<long long> reduced;
+    for (const PresolveRule& rule : rules) reduced.push_back(rule.apply(ins));
+    return reduced;
+}
+
+/* ---------- LP relaxation bound ----------
+   Dantzig-Wolfe relaxation of the remaining cut selection.  Every lab takes
+   a convex combination of its own cut sets (columns z), a shared y_c carries
+   the fractional cuts, and for every lab and candidate c
+        y_c <= lab's weight on c,        sum_c y_c = cuts left.
+   Each column holds exactly "cuts left" cuts, so these rows are tight and
+   all labs see the same fractional cuts.  Columns come from a per-lab DP.
+   For ANY multipliers pi the Lagrangian value
+        sum_i max_S (g_i(S) - sum_{c in S} pi_ic) + (top "cuts left" of sum_i pi_ic)
+   is an upper bound, so the result is valid whenever the loop stops.      */
+
+/* dense revised simplex (max c.x, Ax = b, x >= 0) on a feasible start basis */
+struct LPColumn {
+    vector<pair<int,double>> a;       // (row, value)
+    double cost;
+};
+
+struct RevisedSimplex {
+    int m;
+    vector<double> b, xB, Binv;       // Binv is m*m, row-major
+    vector<LPColumn> cols;
+    vector<int> basis;                // column basic in each row
+    vector<char> isBasic;
+
+    double cB(int r) const { return cols[basis[r]].cost; }
+
+    vector<double> duals() const {
+        vector<double> y(m, 0.0);
+        for (int r = 0; r < m; ++r) {
+            double c = cB(r);
+            if (c == 0) continue;
+            for (int j = 0; j < m; ++j) y[j] += c * Binv[(size_t)r * m + j];
+        }
+        return y;
+    }
+
+    int addColumn(LPColumn col) {
+        cols.push_back(move(col));
+        isBasic.push_back(0);
+        return cols.size() - 1;
+    }
+
+    /* pivots until no column prices out or maxPivots is reached; switches to
+       Bland's rule after a run of degenerate pivots so it cannot cycle */
+    void optimise(int maxPivots) {
+        const double eps = 1e-9;
+        int degenerate = 0;
+        vector<double> y = duals(), d(m);
+        vector<int> nz;
+        for (int it = 0; it < maxPivots; ++it) {
+            bool bland = degenerate > 50;
+            int q = -1;
+            double bestRc = eps;
+            for (int j = 0; j < (int)cols.size(); ++j) {
+                if (isBasic[j]) continue;
+                double rc = cols[j].cost;
+                for (auto [row, v] : cols[j].a) rc -= y[row] * v;
+                if (rc > bestRc) { q = j; bestRc = rc; if (bland) break; }
+            }
+            if (q < 0) return;
+
+            for (int r = 0; r < m; ++r) {
+                double s = 0;
+                for (auto [row, v] : cols[q].a) s += Binv[(size_t)r * m + row] * v;
+                d[r] = s;
+            }
+            int out = -1;
+            double theta = 0;
+            for (int r = 0; r < m; ++r) {
+                if (d[r] <= eps) continue;
+                double ratio = xB[r] / d[r];
+                if (out < 0 || ratio < theta - eps ||
+                    (ratio <= theta + eps && basis[r] < basis[out])) {
+                    out = r;
+                    theta = ratio;
+                }
+            }
+            if (out < 0) return;                      // unbounded: cannot happen here
+            degenerate = theta <= eps ? degenerate + 1 : 0;
+
+            for (int r = 0; r < m; ++r) if (r != out) xB[r] -= theta * d[r];
+            xB[out] = theta;
+            double* pr = &Binv[(size_t)out * m];
+            nz.clear();
+            for (int j = 0; j < m; ++j)
+                if (pr[j] != 0) { pr[j] /= d[out]; nz.push_back(j); }
+            for (int r = 0; r < m; ++r) {
+                if (r == out || d[r] == 0) continue;
+                double* row = &Binv[(size_t)r * m];
+                for (int j : nz) row[j] -= d[r] * pr[j];
+            }
+            for (int j : nz) y[j] += bestRc * pr[j];  // y' = y + rc_q * new pivot row
+            isBasic[basis[out]] = 0;
+            isBasic[q] = 1;
+            basis[out] = q;
+        }
+    }
+};
+
+/* best R cuts for one lab among finishTimes[first..], maximising counted usage
+   minus pi[c] per cut taken.  ready after a cut is max(ready0, last cut), so the
+   DP state is (cuts taken, last cut, idx).  Returns -inf if R cuts do not fit;
+   fills cuts (candidate offsets from first) and gain (usage without pi). */
+double priceLab(const Lab& lab, const vector<int>& finishTimes, int first, int R,
+                int T, int idx0, int ready0, const vector<double>& pi,
+                vector<int>& cuts, long long& gain)
+{
+    const int Kr = (int)finishTimes.size() - first;
+    const int S  = lab.p.size();
+    const double NEG = -1e300;
+    if (Kr < R) return NEG;
+
+    auto readyAt = [&](int j) {                  // j = 0: no cut yet, else cut j-1
+        return j == 0 ? ready0 : max(ready0, finishTimes[first + j - 1]);
+    };
+    auto run = [&](int idx, int ready, int cut, long long& g) {
+        int t = ready;
+        while (idx < S && t + lab.p[idx] <= cut) { g += lab.p[idx]; t += lab.p[idx]; idx++; }
+        return idx;
+    };
+
+    /* V[k][j][idx], choice[k][j][idx] = next j */
+    const int J = Kr + 1, I = S + 1;
+    auto at = [&](int k, int j, int idx) { return ((size_t)k * J + j) * I + idx; };
+    vector<double> V((size_t)(R + 1) * J * I, NEG);
+    vector<int> choice(V.size(), -1);
+
+    for (int j = 0; j < J; ++j) {
+        if ((j == 0) != (R == 0)) continue;
+        for (int idx = idx0; idx <= S; ++idx) {
+            long long g = 0;
+            run(idx, readyAt(j), T, g);
+            V[at(R, j, idx)] = (double)g * lab.mult;
+        }
+    }
+    for (int k = R - 1; k >= 0; --k)
+        for (int j = (k == 0 ? 0 : k); j < J; ++j) {
+            if (k == 0 && j != 0) break;
+            for (int idx = idx0; idx <= S; ++idx) {
+                double best = NEG;
+                int arg = -1;
+                for (int j2 = j + 1; j2 <= Kr - (R - k - 1); ++j2) {
+                    long long g = 0;
+                    int idx2 = run(idx, readyAt(j), finishTimes[first + j2 - 1], g);
+                    double next = V[at(k + 1, j2, idx2)];
+                    if (next == NEG) continue;
+                    double v = (double)g * lab.mult - pi[j2 - 1] + next;
+                    if (v > best) { best = v; arg = j2; }
+                }
+                V[at(k, j, idx)] = best;
+                choice[at(k, j, idx)] = arg;
+            }
+        }
+
+    /* replay the arg-max path for the column and its plain gain */
+    cuts.clear();
+    gain = 0;
+    int j = 0, idx = idx0;
+    for (int k = 0; k < R; ++k) {
+        int j2 = choice[at(k, j, idx)];
+        long long g = 0;
+        idx = run(idx, readyAt(j), finishTimes[first + j2 - 1], g);
+        gain += g * lab.mult;
+        cuts.push_back(j2 - 1);
+        j = j2;
+    }
+    long long g = 0;
+    run(idx, readyAt(j), T, g);
+    gain += g * lab.mult;
+    return V[at(0, 0, idx0)];
+}
+
+/* upper bound on the usage still to come from a node with R cuts left,
+   candidates finishTimes[first..] and per-lab (idx, ready); -1 if no
+   complete cut set exists below the node.  Stops early once the bound
+   drops to target. */
+long long lpBound(const vector<Lab>& labs, const vector<int>& finishTimes,
+                  int first, int R, int T,
+                  const vector<int>& idx, const vector<int>& ready,
+                  long long target = LLONG_MIN, int maxRounds = 30)
+{
+    const int n = labs.size();
+    const int Kr = (int)finishTimes.size() - first;
+    if (Kr < R) return -1;
+
+    /* rows: conv i (n) | link (i,c) (n*Kr) | card (1) */
+    const int m = n + n * Kr + 1;
+    auto link = [&](int i, int c) { return n + i * Kr + c; };
+    const int card = m - 1;
+
+    vector<vector<double>> piLab(n, vector<double>(Kr, 0.0));
+    double bound = 1e300;
+
+    auto lagrangian = [&](vector<vector<int>>& colCuts, vector<long long>& colGain,
+                          vector<double>& value) {
+        double total = 0;
+        vector<double> w(Kr, 0.0);
+        for (int i = 0; i < n; ++i) {
+            value[i] = priceLab(labs[i], finishTimes, first, R, T,
+                                idx[i], ready[i], piLab[i], colCuts[i], colGain[i]);
+            total += value[i];
+            for (int c = 0; c < Kr; ++c) w[c] += piLab[i][c];
+        }
+        sort(w.rbegin(), w.rend());
+        for (int c = 0; c < R; ++c) total += w[c];
+        bound = min(bound, total);
+    };
+
+    vector<vector<int>> colCuts(n);
+    vector<long long> colGain(n);
+    vector<double> value(n);
+    lagrangian(colCuts, colGain, value);       // pi = 0: sum of per-lab optima
+    if (R == 0 || n == 0) return (long long)floor(bound + 1e-6);
+
+    /* start basis: one column per lab, link slacks, artificial on card row */
+    RevisedSimplex lp;
+    lp.m = m;
+    lp.b.assign(m, 0.0);
+    for (int i = 0; i < n; ++i) lp.b[i] = 1;
+    lp.b[card] = R;
+    lp.basis.assign(m, -1);
+    lp.Binv.assign((size_t)m * m, 0.0);
+    for (int r = 0; r < m; ++r) lp.Binv[(size_t)r * m + r] = 1;
+    lp.xB = lp.b;
+
+    double bigM = 1;
+    for (int i = 0; i < n; ++i)
+        for (int p : labs[i].p) bigM += 1.0 * p * labs[i].mult;
+    bigM *= 10;
+
+    auto patternColumn = [&](int i, const vector<int>& cs, long long g) {
+        LPColumn col{{{i, 1.0}}, (double)g};
+        for (int c : cs) col.a.push_back({link(i, c), -1.0});
+        return col;
+    };
+    for (int i = 0; i < n; ++i) {
+        int q = lp.addColumn(patternColumn(i, colCuts[i], colGain[i]));
+        lp.basis[i] = q;
+        lp.isBasic[q] = 1;
+        for (int c : colCuts[i]) {                // B = [[I,0],[-E,I]] -> Binv = [[I,0],[E,I]]
+            lp.Binv[(size_t)link(i, c) * m + i] = 1;
+            lp.xB[link(i, c)] = 1;
+        }
+    }
+    for (int i = 0; i < n; ++i)
+        for (int c = 0; c < Kr; ++c) {
+            int q = lp.addColumn({{{link(i, c), 1.0}}, 0.0});   // slack
+            lp.basis[link(i, c)] = q;
+            lp.isBasic[q] = 1;
+        }
+    int art = lp.addColumn({{{card, 1.0}}, -bigM});
+    lp.basis[card] = art;
+    lp.isBasic[art] = 1;
+    for (int c = 0; c < Kr; ++c) {                // y_c
+        LPColumn col{{{card, 1.0}}, 0.0};
+        for (int i = 0; i < n; ++i) col.a.push_back({link(i, c), 1.0});
+        lp.addColumn(move(col));
+    }
+
+    for (int round = 0; round < maxRounds; ++round)
+    {
+        if (floor(bound + 1e-6) <= target) break;
+        lp.optimise(20 * m);
+        vector<double> y = lp.duals();
+        for (int i = 0; i < n; ++i)
+            for (int c = 0; c < Kr; ++c) piLab[i][c] = -y[link(i, c)];
+
+        lagrangian(colCuts, colGain, value);
+        bool added = false;
+        for (int i = 0; i < n; ++i)
+            if (value[i] > y[i] + 1e-7) {
+                lp.addColumn(patternColumn(i, colCuts[i], colGain[i]));
+                added = true;
+            }
+        if (!added) break;                        // master is LP-optimal
+    }
+    return (long long)floor(bound + 1e-6);
+}
+
+
+/* ---------- Lab-parallel block simulation ----------
+   With thousands of labs the per-node block simulation dominates the DFS.
+   A persistent pool splits the lab range into one chunk per thread; the
+   calling thread runs chunk 0 itself and the chunk sums are added up once
+   all are in.  Opt-in through --threads=N: the 1024-lab floor is a guess
+   that has not been measured on a multi-core box, so by default the
+   search stays serial.                                                    */
+struct LabPool {
+    static constexpr int minLabs = 1024;   // unmeasured; smaller instances stay serial
+
+    struct alignas(64) Part { long long v = 0; };
+    vector<thread> workers;
+    vector<Part> part;                // one per chunk, own cache line
+    mutex m;
+    condition_variable wake, done;
+    const function<long long(int,int)>* job = nullptr;
+    int n = 0, pending = 0;
+    unsigned generation = 0;
+    bool stop = false;
+
+    explicit LabPool(int threads) : part(threads)
+    {
+        for (int w = 1; w < threads; ++w) workers.emplace_back([this, w] { run(w); });
+    }
+    ~LabPool()
+    {
+        { lock_guard<mutex> g(m); stop = true; }
+        wake.notify_all();
+        for (thread& t : workers) t.join();
+    }
+
+    int chunks() const { return part.size(); }
+    int bound(int w) const { return (int)(1LL * n * w / chunks()); }
+
+    void run(int w)
+    {
+        unsigned seen = 0;
+        unique_lock<mutex> g(m);
+        for (;;) {
+            wake.wait(g, [&] { return stop || generation != seen; });
+            if (stop) return;
+            seen = generation;
+            g.unlock();
+            part[w].v = (*job)(bound(w), bound(w + 1));
+            g.lock();
+            if (--pending == 0) done.notify_one();
+        }
+    }
+
+    /* f(lo, hi) over [0, count) in chunks; returns the sum of the results */
+    long long sum(int count, const function<long long(int,int)>& f)
+    {
+        {
+            lock_guard<mutex> g(m);
+            job = &f;
+            n = count;
+            pending = chunks() - 1;
+            ++generation;
+        }
+        wake.notify_all();
+        long long total = f(0, bound(1));
+        unique_lock<mutex> g(m);
+        done.wait(g, [&] { return pending == 0; });
+        for (int w = 1; w < chunks(); ++w) total += part[w].v;
+        return total;
+    }
+};
+
+
+/* ---------- Search control shared by the DFS engines ---------- */
+/* cooperative cancellation: cancel() from any thread, and every search
+   polling the token unwinds at its next node */
+struct CancelToken {
+    atomic<bool> flag{false};
+    void cancel() { flag.store(true, memory_order_relaxed); }
+    bool cancelled() const { return flag.load(memory_order_relaxed); }
+};
+
+/* Unproven: a bounded heuristic (routed LDS) stopped before covering every
+   cut set, so best_usage is achievable but may be below the optimum */
+enum class SolveStatus { Optimal, TimedOut, Cancelled, Unproven };
+
+const char* statusName(SolveStatus s)
+{
+    return s == SolveStatus::Optimal  ? "optimal"  : s == SolveStatus::TimedOut ? "timeout"
+         : s == SolveStatus::Unproven ? "unproven" : "cancelled";
+}
+
+struct SearchControl {
+    int lpDepth = -1;                 // LP bound on nodes 1..lpDepth deep
+    long long ceiling = LLONG_MAX;    // root LP certificate: stop once best reaches it
+    long long nodes = 0;              // search nodes entered
+
+    /* rank window: only complete cut sets whose lexicographic rank among the
+       C-subsets of finishTimes lies in [rankLo, rankHi) are visited */
+    unsigned long long rankLo = 0, rankHi = ULLONG_MAX;
+    vector<vector<unsigned long long>> binom;   // empty when ranks are not tracked
+
+    /* called every 4096 nodes with the rank of the first leaf not yet
+       settled and the incumbent (checkpoints) */
+    function<void(unsigned long long, long long)> onTick;
+
+    vector<int> bestCuts;             // cut times of the incumbent, once a search improved it
+    LabPool* pool = nullptr;          // dfsRecursive splits its lab loops over it
+
+    /* early stops: a token any thread may cancel, and a deadline read off
+       the clock every 1024 nodes.  Once either fires, status says which
+       and every later poll unwinds at once.                              */
+    const CancelToken* cancel = nullptr;
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();
+    SolveStatus status = SolveStatus::Optimal;
+
+    atomic<long long>* shared = nullptr;   // portfolio: incumbent exchanged with other engines
+
+    bool ranked() const { return !binom.empty(); }
+
+    /* once per node, after nodes was counted: true -> unwind now; otherwise
+       best and the shared incumbent are brought up to each other */
+    bool poll(long long& best)
+    {
+        if (status != SolveStatus::Optimal) return true;
+        if (cancel && cancel->cancelled()) {
+            status = SolveStatus::Cancelled;
+            return true;
+        }
+        if ((nodes & 1023) == 0 && deadline != chrono::steady_clock::time_point::max() &&
+            chrono::steady_clock::now() >= deadline) {
+            status = SolveStatus::TimedOut;
+            return true;
+        }
+        if (shared) {
+            long long s = shared->load(memory_order_relaxed);
+            while (s < best && !shared->compare_exchange_weak(s, best, memory_order_relaxed)) {}
+            best = max(best, s);
+        }
+        return false;
+    }
+    /* k-subsets of the last r candidates */
+    unsigned long long subsets(int r, int k) const { return binom[r][k]; }
+};
+
+/* binom[r][k] = r choose k for r <= n, k <= kmax, saturating at ULLONG_MAX */
+vector<vector<unsigned long long>> binomialTable(int n, int kmax)
+{
+    vector<vector<unsigned long long>> b(n + 1, vector<unsigned long long>(kmax + 1, 0));
+    for (int r = 0; r <= n; ++r) {
+        b[r][0] = 1;
+        for (int k = 1; k <= kmax && r > 0; ++k) {
+            unsigned long long x = b[r - 1][k - 1], y = b[r - 1][k];
+            b[r][k] = (x > ULLONG_MAX - y) ? ULLONG_MAX : x + y;
+        }
+    }
+    return b;
+}
+
+/* C-subset of {0..K-1} with lexicographic rank r (the DFS visiting order) */
+vector<int> unrankSubset(const vector<vector<unsigned long long>>& binom,
+                         int K, int C, unsigned long long r)
+{
+    vector<int> ids;
+    int id = 0;
+    for (int k = C; k > 0; --k, ++id) {
+        while (r >= binom[K - 1 - id][k - 1]) r -= binom[K - 1 - id][k - 1], ++id;
+        ids.push_back(id);
+    }
+    return ids;
+}
+
+
+/* ---------- Helper DFS with *working* branch-and-bound ---------- */
+/* runs labs [lo, hi) through the block ending at cut; returns counted usage */
+long long simulateBlock(const vector<Lab>& labs, int lo, int hi, int cut,
+                        vector<int>& idx, vector<int>& busy, vector<int>& avail)
+{
+    long long gain = 0;
+    for (int i = lo; i < hi; ++i)
+    {
+        int t = max(avail[i], busy[i]);
+        while (idx[i] < (int)labs[i].p.size() &&
+               t + labs[i].p[idx[i]] <= cut)
+        {
+            gain += 1LL * labs[i].mult * labs[i].p[idx[i]];
+            t    += labs[i].p[idx[i]];
+            busy[i] = t;
+            idx[i]++;
+        }
+        if (busy[i] <= cut) avail[i] = cut;   // clean only if idle
+    }
+    return gain;
+}
+
+long long simulateBlock(const vector<Lab>& labs, int cut, vector<int>& idx,
+                        vector<int>& busy, vector<int>& avail, LabPool* pool)
+{
+    int n = labs.size();
+    if (!pool) return simulateBlock(labs, 0, n, cut, idx, busy, avail);
+    return pool->sum(n, [&](int lo, int hi) {
+        return simulateBlock(labs, lo, hi, cut, idx, busy, avail);
+    });
+}
+
 void dfsRecursive(const vector<Lab>& labs,
                   const vector<int>& finishTimes,
                   vector<int>& inspections,
                   int nextIdx,
-                  int C, int T, int L,
+                  int C, int T, int L,        // L = labs in play, counting mult
                   long long& bestUsage,
                   long long usedSoFar,
                   int lastCut,
                   vector<int>& idx,
                   vector<int>& busy,
-                  vector<int>& avail)
+                  vector<int>& avail,
+                  SearchControl& ctl,
+                  unsigned long long rankBase = 0)  // rank of the first leaf below
 {
+    if ((++ctl.nodes & 4095) == 0 && ctl.onTick) ctl.onTick(rankBase, bestUsage);
+    if (ctl.poll(bestUsage)) return;
+
     /* --- optimistic bound (now tight) --- */
-    long long optimistic = usedSoFar + 1LL * (T - lastCut) * L;
+    long long optimistic = min(usedSoFar + 1LL * (T - lastCut) * L, ctl.ceiling);
     if (optimistic <= bestUsage) return;   // prune branch
 
+    int depth = inspections.size();
+    if (depth > 0 && depth <= ctl.lpDepth && depth < C)
+    {
+        vector<int> ready(labs.size());
+        for (size_t i = 0; i < labs.size(); ++i) ready[i] = max(avail[i], busy[i]);
+        long long lp = lpBound(labs, finishTimes, nextIdx, C - depth, T,
+                               idx, ready, bestUsage - usedSoFar);
+        if (lp < 0 || usedSoFar + lp <= bestUsage) return;
+    }
+
     /* --- placed all C inspections -> simulate remaining block to T --- */
     if ((int)inspections.size() == C)
     {
-        long long used = usedSoFar;
-        int cut = T;
-
-        for (int i = 0; i < L; ++i)
-        {
-            int t = max(avail[i], busy[i]);
-            while (idx[i] < (int)labs[i].p.size() &&
-                   t + labs[i].p[idx[i]] <= cut)
-            {
-                used += labs[i].p[idx[i]];
-                t    += labs[i].p[idx[i]];
-                busy[i] = t;
-                idx[i]++;
-            }
+        long long used = usedSoFar + simulateBlock(labs, T, idx, busy, avail, ctl.pool);
+        if (used > bestUsage) {
+            bestUsage = used;
+            ctl.bestCuts = inspections;
         }
-        bestUsage = max(bestUsage, used);
         return;
     }
 
     /* --- recursive step: try next inspection time --- */
-    for (int id = nextIdx; id < (int)finishTimes.size(); ++id)
+    const int K = finishTimes.size();
+    unsigned long long rank = rankBase;
+    for (int id = nextIdx; id < K; ++id)
     {
         int cut = finishTimes[id];
         if (cut >= T) break;
 
+        unsigned long long childRank = rank;
+        if (ctl.ranked()) {            // skip subtrees outside the rank window
+            rank += ctl.subsets(K - 1 - id, C - depth - 1);
+            if (rank <= ctl.rankLo || childRank >= ctl.rankHi) continue;
+        }
+
         /* simulate block [lastCut , cut) once */
         vector<int> idx2   = idx;
         vector<int> busy2  = busy;
         vector<int> avail2 = avail;
-        long long   gain   = 0;
-
-        for (int i = 0; i < L; ++i)
-        {
-            int t = max(avail2[i], busy2[i]);
-            while (idx2[i] < (int)labs[i].p.size() &&
-                   t + labs[i].p[idx2[i]] <= cut)
-            {
-                gain += labs[i].p[idx2[i]];
-                t    += labs[i].p[idx2[i]];
-                busy2[i] = t;
-                idx2[i]++;
-            }
-            if (busy2[i] <= cut) avail2[i] = cut;   // clean only if idle
-        }
+        long long   gain   = simulateBlock(labs, cut, idx2, busy2, avail2, ctl.pool);
 
         inspections.push_back(cut);
         dfsRecursive(labs, finishTimes, inspections,
                      id + 1, C, T, L,
                      bestUsage, usedSoFar + gain, cut,
-                     idx2, busy2, avail2);
+                     idx2, busy2, avail2, ctl, childRank);
         inspections.pop_back();
     }
 }
 
 
-/* ---------- Exact solver: build finishTimes and call DFS ---------- */
-pair<long long,long long> solveExact(const Instance& ins)
-{
-    int L = ins.L, C = ins.C, T = ins.T;
-    const auto& labs = ins.labs;
+/* ---------- Specialised DFS kernels for small instances ----------
+   Same search and bound as dfsRecursive, but with the lab count padded to N
+   and each lab's periods padded to P, so the per-lab loops have a fixed
+   trip count and the whole state lives in std::arrays on the stack.  Padding
+   labs have no students and mult 0, so they never contribute.             */
+template <int N, int P>
+struct SmallKernel {
+    array<array<int, P>, N> p{};
+    array<int, N> cnt{}, mult{};
+    const vector<Lab>* labs = nullptr;
+    const vector<int>* finishTimes = nullptr;
+    int K = 0, C = 0, T = 0, L = 0;
+    SearchControl* ctl = nullptr;
+    long long best = 0;
+    vector<int> path;                 // candidate ids of the cuts placed so far
 
-    vector<int> finishTimes;
-    for (int lab = 0; lab < L; ++lab)
+    /* idx / ready as in solveExactDP: ready = max(busy, avail) */
+    void dfs(int nextIdx, int depth, long long usedSoFar, int lastCut,
+             const array<int, N>& idx, const array<int, N>& ready,
+             unsigned long long rankBase)
     {
-        int t = 0;
-        for (int j = 0; j < (int)labs[lab].p.size() && j <= C; ++j)
+        if ((++ctl->nodes & 4095) == 0 && ctl->onTick) ctl->onTick(rankBase, best);
+        if (ctl->poll(best)) return;
+        if (min(usedSoFar + 1LL * (T - lastCut) * L, ctl->ceiling) <= best) return;
+
+        if (depth > 0 && depth <= ctl->lpDepth && depth < C)
+        {
+            int n = labs->size();
+            long long lp = lpBound(*labs, *finishTimes, nextIdx, C - depth, T,
+                                   vector<int>(idx.begin(), idx.begin() + n),
+                                   vector<int>(ready.begin(), ready.begin() + n),
+                                   best - usedSoFar);
+            if (lp < 0 || usedSoFar + lp <= best) return;
+        }
+
+        if (depth == C)
+        {
+            long long used = usedSoFar;
+            for (int i = 0; i < N; ++i)
+            {
+                int t = ready[i];
+                for (int j = idx[i]; j < cnt[i] && t + p[i][j] <= T; ++j)
+                {
+                    used += 1LL * mult[i] * p[i][j];
+                    t    += p[i][j];
+                }
+            }
+            if (used > best) {
+                best = used;
+                ctl->bestCuts.clear();
+                for (int id : path) ctl->bestCuts.push_back((*finishTimes)[id]);
+            }
+            return;
+        }
+
+        unsigned long long rank = rankBase;
+        for (int id = nextIdx; id < K; ++id)
         {
-            t += labs[lab].p[j];
-            if (t < T) finishTimes.push_back(t);
+            unsigned long long childRank = rank;
+            if (ctl->ranked()) {
+                rank += ctl->subsets(K - 1 - id, C - depth - 1);
+                if (rank <= ctl->rankLo || childRank >= ctl->rankHi) continue;
+            }
+
+            int cut = (*finishTimes)[id];
+            array<int, N> idx2 = idx, ready2;
+            long long gain = 0;
+            for (int i = 0; i < N; ++i)
+            {
+                int t = ready[i];
+                while (idx2[i] < cnt[i] && t + p[i][idx2[i]] <= cut)
+                {
+                    gain += 1LL * mult[i] * p[i][idx2[i]];
+                    t    += p[i][idx2[i]];
+                    idx2[i]++;
+                }
+                ready2[i] = (t <= cut) ? cut : t;
+            }
+            path[depth] = id;
+            dfs(id + 1, depth + 1, usedSoFar + gain, cut, idx2, ready2, childRank);
         }
     }
-    sort(finishTimes.begin(), finishTimes.end());
-    finishTimes.erase(unique(finishTimes.begin(), finishTimes.end()),
-                      finishTimes.end());
+};
 
-    /* initial per-lab state */
-    vector<int> idx(L, 1);            // first student already running
-    vector<int> busy(L), avail(L);
-    long long used0 = 0;
-    for (int i = 0; i < L; ++i)
+template <int N, int P>
+long long runSmallKernel(const vector<Lab>& labs, const vector<int>& finishTimes,
+                         int C, int T, int L, long long used0, long long best,
+                         SearchControl& ctl)
+{
+    SmallKernel<N, P> k;
+    array<int, N> idx{}, ready{};
+    for (int i = 0; i < (int)labs.size(); ++i)
     {
-        busy[i]  = labs[i].p.empty() ? 0 : labs[i].p[0];
-        avail[i] = 0;                 // cleaned at t=0
-        used0   += labs[i].p.empty() ? 0 : labs[i].p[0];
+        k.cnt[i]  = labs[i].p.size();
+        k.mult[i] = labs[i].mult;
+        copy(labs[i].p.begin(), labs[i].p.end(), k.p[i].begin());
+        idx[i]    = 1;                // first student already running
+        ready[i]  = labs[i].p.empty() ? 0 : labs[i].p[0];
     }
+    k.labs = &labs;
+    k.finishTimes = &finishTimes;
+    k.K = finishTimes.size();
+    k.C = C; k.T = T; k.L = L;
+    k.ctl = &ctl;
+    k.best = best;
+    k.path.resize(C);
+    k.dfs(0, 0, used0, 0, idx, ready, 0);
+    return k.best;
+}
 
-    long long best = used0;
-    vector<int> insp;
-    dfsRecursive(labs, finishTimes, insp,
-                 0, C, T, L,
-                 best, used0, 0,
-                 idx, busy, avail);
+/* picks the smallest kernel that fits; false -> caller uses dfsRecursive */
+bool trySmallKernel(const vector<Lab>& labs, const vector<int>& finishTimes,
+                    int C, int T, int L, long long used0, long long& best,
+                    SearchControl& ctl)
+{
+    constexpr int P = 8;              // C <= 6 after pruneInstance needs 7
+    for (const Lab& lab : labs)
+        if ((int)lab.p.size() > P) return false;
 
-    long long idle = 1LL * T * L - best;
-    return {best, idle};
+    int n = labs.size();
+    if (n <= 4)  { best = runSmallKernel<4,  P>(labs, finishTimes, C, T, L, used0, best, ctl); return true; }
+    if (n <= 8)  { best = runSmallKernel<8,  P>(labs, finishTimes, C, T, L, used0, best, ctl); return true; }
+    if (n <= 16) { best = runSmallKernel<16, P>(labs, finishTimes, C, T, L, used0, best, ctl); return true; }
+    return false;
 }
 
 
-/* ---------- MAIN ---------- */
-int main() {
-    string inputfile = "500_tight_instances.csv";
-    string outputfile = "500_tight_instancesOutputOptimal.csv";
-    ifstream fin(inputfile);
-    ofstream fout(outputfile);
-    if (!fin) { cerr << "Cannot open input file\n"; return 1; }
-    if (!fout){ cerr << "Cannot open output file\n"; return 1; }
+/* run one lab through the block ending at cut; returns counted usage */
+inline long long advanceLab(const Lab& lab, int& idx, int& ready, int cut)
+{
+    long long gain = 0;
+    int t = ready;
+    while (idx < (int)lab.p.size() && t + lab.p[idx] <= cut) {
+        gain += lab.p[idx];
+        t    += lab.p[idx];
+        idx++;
+    }
+    ready = (t <= cut) ? cut : t;     // idle at the cut -> cleaned, restarts there
+    return gain * lab.mult;
+}
 
-    vector<Instance> instances;
-    string line;
-    /* ------------ PARSE ------------ */
-    while (getline(fin, line)) {
-        if (line.empty() || line[0] == '#' || line.find("instance_id") != string::npos) continue;
-        auto head = splitCSV(line);
-        if (head.size() != 4) { cerr << "Bad header line\n"; return 1; }
-        Instance ins;
-        ins.id = head[0];
-        ins.L  = stoi(head[1]);
-        ins.C  = stoi(head[2]);
-        ins.T  = stoi(head[3]);
+/* ---------- Limited-discrepancy search ----------
+   Children are ordered by the usage they would reach if no later cut
+   interrupted any lab; taking the first child is free, any other costs one
+   discrepancy.  Rounds run with k = 0, 1, ... discrepancies; a round that
+   never hit its limit has seen every cut set, so it proves optimality.   */
+struct LDSearch {
+    const vector<Lab>& labs;
+    const vector<int>& finishTimes;
+    int C, T, L;
+    long long best;
+    long long ceiling = LLONG_MAX;    // stop once best reaches a known bound
+    long long nodes = 0;
+    bool limited = false;             // some child was skipped for lack of budget
+    const CancelToken* stop = nullptr;    // cancelled: give up (unproven)
 
-        ins.labs.clear();
-        for (int i = 0; i < ins.L; ++i) {
-            if (!getline(fin, line)) { cerr << "Unexpected EOF\n"; return 1; }
-            auto row = splitCSV(line);
-            if (row.empty() || row[0] != "lab") { cerr << "Expected 'lab' row\n"; return 1; }
-            int cnt = stoi(row[1]);
-            if ((int)row.size() != cnt + 2) { cerr << "Bad lab row count\n"; return 1; }
-            Lab lab;
-            lab.p.reserve(cnt);
-            for (int k = 0; k < cnt; ++k) lab.p.push_back(stoi(row[2 + k]));
-            ins.labs.push_back(move(lab));
+    void run(int nextIdx, int depth, long long used, int lastCut,
+             const vector<int>& idx, const vector<int>& ready, int budget)
+    {
+        nodes++;
+        if (stop && stop->cancelled()) { limited = true; return; }
+        if (min(used + 1LL * (T - lastCut) * L, ceiling) <= best) return;
+
+        int n = labs.size();
+        if (depth == C) {
+            for (int i = 0; i < n; ++i) {
+                int j = idx[i], r = ready[i];
+                used += advanceLab(labs[i], j, r, T);
+            }
+            best = max(best, used);
+            return;
+        }
+
+        struct Child { long long score, gain; int id; vector<int> idx, ready; };
+        vector<Child> kids;
+        int K = finishTimes.size();
+        for (int id = nextIdx; id + (C - depth - 1) < K; ++id) {
+            Child c{0, 0, id, idx, ready};
+            long long freeRun = 0;
+            for (int i = 0; i < n; ++i) {
+                c.gain += advanceLab(labs[i], c.idx[i], c.ready[i], finishTimes[id]);
+                int j = c.idx[i], r = c.ready[i];
+                freeRun += advanceLab(labs[i], j, r, T);
+            }
+            c.score = c.gain + freeRun;
+            kids.push_back(move(c));
+        }
+        stable_sort(kids.begin(), kids.end(),
+                    [](const Child& a, const Child& b) { return a.score > b.score; });
+
+        for (size_t k = 0; k < kids.size(); ++k) {
+            int cost = k == 0 ? 0 : 1;
+            if (cost > budget) { limited = true; break; }
+            const Child& c = kids[k];
+            run(c.id + 1, depth + 1, used + c.gain, finishTimes[c.id], c.idx, c.ready, budget - cost);
         }
-        instances.push_back(move(ins));
     }
+};
 
-    /* ------------ PROCESS & OUTPUT ------------ */
-    fout << "instance_id,best_usage,idle_time,labs,counted_students\n";
-    for (Instance& ins : instances) {
-        pruneInstance(ins);
+/* rounds k = 0..maxK (or until a round proves optimality); trace gets
+   (k, best after round k).  Returns the best usage found. */
+long long runLDS(const vector<Lab>& labs, const vector<int>& finishTimes,
+                 int C, int T, int L, long long used0, long long best,
+                 int maxK, long long ceiling = LLONG_MAX,
+                 bool* complete = nullptr, vector<pair<int,long long>>* trace = nullptr,
+                 const CancelToken* stop = nullptr)
+{
+    int n = labs.size();
+    vector<int> idx(n, 1), ready(n);          // first student already running
+    for (int i = 0; i < n; ++i) ready[i] = labs[i].p.empty() ? 0 : labs[i].p[0];
 
-        long long counted = 0;
-        for (const Lab& lab : ins.labs) counted += lab.p.size();
+    LDSearch lds{labs, finishTimes, C, T, L, best};
+    lds.ceiling = ceiling;
+    lds.stop = stop;
+    if (complete) *complete = false;
+    for (int k = 0; k <= maxK; ++k) {
+        lds.limited = false;
+        lds.run(0, 0, used0, 0, idx, ready, k);
+        if (trace) trace->push_back({k, lds.best});
+        if (!lds.limited || lds.best >= ceiling) {
+            if (complete) *complete = true;
+            break;
+        }
+    }
+    return lds.best;
+}
 
-        auto [used,idle] = solveExact(ins);      // plug in your brute-force later
-        fout << ins.id << ',' << used << ',' << idle << ','
-             << ins.L  << ',' << counted << '\n';
+
+/* ---------- Transition-table engine ----------
+   Given the cut candidates, a lab can only ever be in a handful of
+   (idx, ready) states.  Each lab gets a table state x candidate -> (next
+   state, gain), plus each state's usage to T if no further cut came.  A
+   search node is then n table lookups, and since further cuts only cost
+   usage, used + the sum of those free runs is an exact optimistic bound,
+   much tighter than dfsRecursive's (T - lastCut) * L.  Rows are filled the
+   first time the search expands a state, so easy instances that the bound
+   settles near the root never pay for the whole table.                    */
+struct LabTable {
+    Lab lab;                          // a copy, so a table can outlive its instance
+    vector<int> idx, ready;           // per state
+    vector<long long> rest;           // per state: usage of the block up to T
+    vector<char> filled;              // per state: row computed
+    vector<uint32_t> next;            // [state * K + candidate]
+    vector<long long> gain;           // same layout, mult applied
+    unordered_map<long long, int> ids;
+
+    int state(int i, int r, int K, int T)
+    {
+        auto [it, added] = ids.try_emplace((long long)i << 32 | r, (int)idx.size());
+        if (added) {
+            idx.push_back(i);
+            ready.push_back(r);
+            rest.push_back(advanceLab(lab, i, r, T));
+            filled.push_back(0);
+            next.resize(idx.size() * K);
+            gain.resize(idx.size() * K);
+        }
+        return it->second;
+    }
+
+    void fillRow(int s, const vector<int>& finishTimes, int T)
+    {
+        const int K = finishTimes.size();
+        /* a cut before ready finds the lab busy: nothing changes */
+        int from = lower_bound(finishTimes.begin(), finishTimes.end(), ready[s]) - finishTimes.begin();
+        for (int c = 0; c < K; ++c)
+        {
+            int i = idx[s], r = ready[s];
+            long long g = c < from ? 0 : advanceLab(lab, i, r, finishTimes[c]);
+            int to = c < from ? s : state(i, r, K, T);
+            next[(size_t)s * K + c] = to;        // state() may have moved next
+            gain[(size_t)s * K + c] = g;
+        }
+        filled[s] = 1;
+    }
+};
+
+/* lab tables kept from one solve to the next (IncrementalSolver); they are
+   reused for labs that are unchanged while the candidates and T are too */
+struct TableMemo {
+    vector<int> finishTimes;
+    int T = -1;
+    vector<LabTable> tabs;
+};
+
+struct TableKernel {
+    vector<LabTable> tabs;
+    const vector<Lab>* labs = nullptr;
+    const vector<int>* finishTimes = nullptr;
+    int K = 0, C = 0, T = 0, n = 0;
+    SearchControl* ctl = nullptr;
+    long long best = 0;
+    vector<uint32_t> st;              // [depth * n + lab]: state after depth cuts
+    vector<int> path;                 // candidate ids of the cuts placed so far
+    size_t entries = 0, maxEntries = 0;
+    bool overflow = false;            // tables outgrew maxEntries: give up
+
+    void dfs(int nextIdx, int depth, long long used, long long rest,
+             unsigned long long rankBase)
+    {
+        if (overflow) return;
+        if ((++ctl->nodes & 4095) == 0 && ctl->onTick) ctl->onTick(rankBase, best);
+        if (ctl->poll(best)) return;
+        if (min(used + rest, ctl->ceiling) <= best) return;
+        if (depth == C) {
+            best = used + rest;       // > best, or the bound above had returned
+            ctl->bestCuts.clear();
+            for (int id : path) ctl->bestCuts.push_back((*finishTimes)[id]);
+            return;
+        }
+
+        const uint32_t* cur = &st[depth * n];
+        for (int i = 0; i < n; ++i)
+        {
+            LabTable& t = tabs[i];
+            if (t.filled[cur[i]]) continue;
+            entries -= t.next.size();
+            t.fillRow(cur[i], *finishTimes, T);
+            entries += t.next.size();
+            if (entries > maxEntries) { overflow = true; return; }
+        }
+
+        if (depth > 0 && depth <= ctl->lpDepth)
+        {
+            vector<int> idx(n), ready(n);
+            for (int i = 0; i < n; ++i) {
+                idx[i]   = tabs[i].idx[cur[i]];
+                ready[i] = tabs[i].ready[cur[i]];
+            }
+            long long lp = lpBound(*labs, *finishTimes, nextIdx, C - depth, T,
+                                   idx, ready, best - used);
+            if (lp < 0 || used + lp <= best) return;
+        }
+
+        uint32_t* nxt = &st[(depth + 1) * n];
+        unsigned long long rank = rankBase;
+        for (int id = nextIdx; id + (C - depth - 1) < K; ++id)
+        {
+            unsigned long long childRank = rank;
+            if (ctl->ranked()) {
+                rank += ctl->subsets(K - 1 - id, C - depth - 1);
+                if (rank <= ctl->rankLo || childRank >= ctl->rankHi) continue;
+            }
+
+            long long gain = 0, rest2 = 0;
+            for (int i = 0; i < n; ++i)
+            {
+                const LabTable& t = tabs[i];
+                size_t e = (size_t)cur[i] * K + id;
+                nxt[i] = t.next[e];
+                gain  += t.gain[e];
+                rest2 += t.rest[nxt[i]];
+            }
+            path[depth] = id;
+            dfs(id + 1, depth + 1, used + gain, rest2, childRank);
+        }
+    }
+};
+
+/* false -> tables outgrew their budget; best still holds what was found
+   and the caller falls back to the other engines.  With a memo, matching
+   tables from the last solve are reused and this solve's are left in it. */
+bool tryTableKernel(const vector<Lab>& labs, const vector<int>& finishTimes,
+                    int C, int T, long long used0, long long& best,
+                    SearchControl& ctl, TableMemo* memo = nullptr)
+{
+    if ((int)finishTimes.size() < C) return false;
+
+    TableKernel k;
+    k.labs = &labs;
+    k.finishTimes = &finishTimes;
+    k.K = finishTimes.size();
+    k.C = C; k.T = T; k.n = labs.size();
+    k.ctl = &ctl;
+    k.best = best;
+    k.maxEntries = 1 << 22;                         // table cells over all labs
+    k.st.assign((C + 1) * k.n, 0);                  // state 0 is each lab's start
+    k.path.resize(C);
+    vector<LabTable>* pool = memo && memo->T == T && memo->finishTimes == finishTimes
+                           ? &memo->tabs : nullptr;
+    long long rest0 = 0;
+    k.tabs.resize(k.n);
+    for (int i = 0; i < k.n; ++i)
+    {
+        LabTable& t = k.tabs[i];
+        for (size_t j = 0; pool && j < pool->size(); ++j)
+        {
+            LabTable& old = (*pool)[j];
+            if (!old.idx.empty() && old.lab.mult == labs[i].mult && old.lab.p == labs[i].p) {
+                t = move(old);
+                old.idx.clear();                    // taken
+                break;
+            }
+        }
+        if (t.idx.empty()) {
+            t.lab = labs[i];
+            t.state(1, labs[i].p.empty() ? 0 : labs[i].p[0], k.K, T);
+        }
+        rest0 += t.rest[0];
+        k.entries += t.next.size();
+    }
+    k.dfs(0, 0, used0, rest0, 0);
+    best = k.best;
+    if (memo) *memo = {finishTimes, T, move(k.tabs)};
+    return !k.overflow;
+}
+
+
+/* ---------- Scoring a complete cut set ---------- */
+/* usage of the whole instance for sorted cuts (< T), with dfsRecursive's
+   block semantics; fixed usage of presolved labs included */
+long long evaluateCuts(const Instance& ins, const vector<int>& cuts)
+{
+    long long used = ins.fixedUsage;
+    for (const Lab& lab : ins.labs)
+    {
+        if (lab.p.empty()) continue;
+        long long u = lab.p[0];       // first student already running
+        int idx = 1, busy = lab.p[0], avail = 0;
+        for (size_t k = 0; k <= cuts.size(); ++k)
+        {
+            int cut = k < cuts.size() ? cuts[k] : ins.T;
+            int t = max(avail, busy);
+            while (idx < (int)lab.p.size() && t + lab.p[idx] <= cut)
+            {
+                u   += lab.p[idx];
+                t   += lab.p[idx];
+                busy = t;
+                idx++;
+            }
+            if (busy <= cut) avail = cut;
+        }
+        used += u * lab.mult;
+    }
+    return used;
+}
+
+
+/* many cut sets at once, same semantics as evaluateCuts (sorted cuts < T).
+   A block runs the longest run of remaining students that fits in
+   cut - ready.  With P the lab's prefix sums and done = P[idx], that is
+   done' = largest P[m] <= cut - ready + done (or done), ready' = max(ready,
+   cut): branch free and gather free, so each lab is processed for the
+   whole batch in flat loops over the cut sets.  Shorter sets are padded
+   with cuts at T, which change nothing. */
+using CutVector = vector<int>;
+
+vector<long long> evaluateBatch(const Instance& ins, span<const CutVector> sets)
+{
+    const int B = sets.size();
+    if (B == 0) return {};
+    size_t depth = 0;
+    for (const CutVector& c : sets) depth = max(depth, c.size());
+
+    /* cut k of every set, k-major; row depth (all T) closes the last block */
+    vector<int> cutAt((depth + 1) * B, ins.T);
+    for (int b = 0; b < B; ++b)
+        for (size_t k = 0; k < sets[b].size(); ++k) cutAt[k * B + b] = sets[b][k];
+
+    vector<long long> used(B, ins.fixedUsage);
+    vector<int> done(B), ready(B), lim(B);
+    vector<int> P;
+    for (const Lab& lab : ins.labs)
+    {
+        const int S = lab.p.size();
+        if (S == 0) continue;
+        P.assign(S + 1, 0);
+        for (int j = 0; j < S; ++j) P[j + 1] = P[j] + lab.p[j];
+
+        fill(done.begin(), done.end(), P[1]);         // first student already running
+        fill(ready.begin(), ready.end(), P[1]);
+        for (size_t k = 0; k <= depth; ++k)
+        {
+            const int* cut = &cutAt[k * B];
+            for (int b = 0; b < B; ++b) lim[b] = cut[b] - ready[b] + done[b];
+            for (int m = 2; m <= S; ++m)
+            {
+                const int v = P[m];
+                for (int b = 0; b < B; ++b) done[b] = (v <= lim[b] && v > done[b]) ? v : done[b];
+            }
+            for (int b = 0; b < B; ++b) ready[b] = max(ready[b], cut[b]);
+        }
+        for (int b = 0; b < B; ++b) used[b] += 1LL * done[b] * lab.mult;
+    }
+    return used;
+}
+
+
+/* ---------- Exact solver: build finishTimes and call DFS ---------- */
+struct SolveOptions {
+    bool specialised = true;          // use SmallKernel when the instance fits
+    bool tables      = true;          // ... and TableKernel before it when its tables fit
+    int  lpDepth     = -1;            // LP bound at the root (0) and down to this depth
+
+    /* static sharding: this run only covers cut-set ranks
+       [N*shard/shards, N*(shard+1)/shards) of the N = |finishTimes| choose C */
+    int shard = 0, shards = 1;
+    long long incumbent = -1;         // known achievable usage, e.g. from another run
+    long long ceiling = LLONG_MAX;    // known upper bound on best_usage, e.g. from an earlier solve
+    TableMemo* tableMemo = nullptr;   // TableKernel tables kept between solves
+    int threads = 1;                  // lab-parallel dfsRecursive from LabPool::minLabs
+                                      // labs up; 1 = serial, 0 = hardware threads
+    const CancelToken* cancel = nullptr;  // cooperative cancellation from another thread
+    double timeLimit = 0;                 // seconds for the search, 0 = none
+    atomic<long long>* shared = nullptr;  // portfolio: incumbent shared across engines
+    unsigned long long seed = 0;      // seeds the sampled starting incumbent
+    int samples = 0;                  // random complete cut sets scored before searching
+
+    int ldsRounds = -1;               // seed the incumbent with LDS rounds k = 0..ldsRounds
+                                      // (--engine=lds: stop after them, unproven)
+
+    /* checkpointing: onCheckpoint gets (first unsettled rank, incumbent, nodes)
+       every 4096 nodes; a resumed run passes them back as resumeRank,
+       incumbent and resumeNodes */
+    function<void(unsigned long long, long long, long long)> onCheckpoint;
+    unsigned long long resumeRank = 0;
+    long long resumeNodes = 0;
+};
+
+struct SolveStats {
+    long long lpBound = -1;           // root LP certificate: best_usage <= lpBound
+    long long nodes   = 0;            // search nodes entered
+    vector<int> cuts;                 // cut times reaching best_usage; empty when the
+                                      // search never beat its starting incumbent
+    SolveStatus status = SolveStatus::Optimal;   // otherwise best_usage is the
+                                                 // incumbent when the search stopped
+};
+
+/* root LP certificate for the whole instance (fixed usage included) */
+long long rootLPBound(const Instance& ins, const vector<int>& finishTimes)
+{
+    int n = ins.labs.size();
+    vector<int> idx(n, 1), ready(n);
+    long long used0 = ins.fixedUsage;
+    for (int i = 0; i < n; ++i) {
+        ready[i] = ins.labs[i].p.empty() ? 0 : ins.labs[i].p[0];
+        used0 += 1LL * ins.labs[i].mult * ready[i];
+    }
+    long long lp = lpBound(ins.labs, finishTimes, 0, ins.C, ins.T, idx, ready);
+    return lp < 0 ? used0 : used0 + lp;   // no complete cut set: only first students
+}
+
+pair<long long,long long> solveExact(const Instance& ins,
+                                     const SolveOptions& opt = {},
+                                     SolveStats* stats = nullptr)
+{
+    int C = ins.C, T = ins.T;
+    const auto& labs = ins.labs;
+    int n = labs.size();
+    const vector<int> finishTimes = ins.presolved ? ins.finishTimes
+                                                  : buildFinishTimes(ins);
+
+    /* initial per-lab state */
+    vector<int> idx(n, 1);            // first student already running
+    vector<int> busy(n), avail(n);
+    long long used0 = ins.fixedUsage;
+    int L = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        busy[i]  = labs[i].p.empty() ? 0 : labs[i].p[0];
+        avail[i] = 0;                 // cleaned at t=0
+        used0   += 1LL * labs[i].mult * (labs[i].p.empty() ? 0 : labs[i].p[0]);
+        L       += labs[i].mult;
+    }
+
+    long long best = max(used0, opt.incumbent);
+    SearchControl ctl;
+    ctl.lpDepth = opt.lpDepth;
+    ctl.cancel  = opt.cancel;
+    ctl.shared  = opt.shared;
+    if (opt.timeLimit > 0)
+        ctl.deadline = chrono::steady_clock::now() +
+                       chrono::duration_cast<chrono::steady_clock::duration>(
+                           chrono::duration<double>(opt.timeLimit));
+    if (opt.lpDepth >= 0)
+    {
+        ctl.ceiling = rootLPBound(ins, finishTimes);   // the search stops once best reaches it
+        if (stats) stats->lpBound = ctl.ceiling;
+    }
+    ctl.ceiling = min(ctl.ceiling, opt.ceiling);
+
+    const int K = finishTimes.size();
+    bool track = opt.shards > 1 || (bool)opt.onCheckpoint;
+    if (track || opt.samples > 0)
+    {
+        auto binom = binomialTable(K, C);
+        unsigned long long N = binom[K][C];
+        if (N == ULLONG_MAX) {
+            // too many cut sets to rank: shard 0 searches everything
+            if (opt.shard > 0) ctl.rankHi = 0;
+        } else {
+            ctl.rankLo = (unsigned long long)((unsigned __int128)N * opt.shard / opt.shards);
+            ctl.rankHi = (unsigned long long)((unsigned __int128)N * (opt.shard + 1) / opt.shards);
+            ctl.rankLo = max(ctl.rankLo, opt.resumeRank);   // settled before the checkpoint
+        }
+
+        /* same seed -> same sample in every shard, so the work each shard
+           does is fixed by (instance, seed, shard) alone */
+        mt19937_64 rng(opt.seed);
+        vector<CutVector> sample;
+        for (int k = 0; k < opt.samples && N > 0 && N < ULLONG_MAX; ++k) {
+            CutVector cuts;
+            for (int id : unrankSubset(binom, K, C, rng() % N)) cuts.push_back(finishTimes[id]);
+            sample.push_back(move(cuts));
+        }
+        if (!sample.empty())
+            for (long long u : evaluateBatch(ins, sample)) best = max(best, u);
+        if (track && N < ULLONG_MAX) ctl.binom = move(binom);
+    }
+    if (opt.ldsRounds >= 0)
+    {
+        bool complete;
+        best = runLDS(labs, finishTimes, C, T, L, used0, best,
+                      opt.ldsRounds, ctl.ceiling, &complete, nullptr, opt.cancel);
+        if (complete) ctl.ceiling = best;   // LDS proved it: the DFS returns at once
+    }
+    ctl.nodes = opt.resumeNodes;
+    if (opt.onCheckpoint)
+        ctl.onTick = [&](unsigned long long rank, long long b) { opt.onCheckpoint(rank, b, ctl.nodes); };
+
+    int threads = opt.threads > 0 ? opt.threads : (int)thread::hardware_concurrency();
+    unique_ptr<LabPool> pool;
+    if (n >= LabPool::minLabs && threads > 1) pool = make_unique<LabPool>(threads);
+    ctl.pool = pool.get();
+
+    if (ctl.rankLo < ctl.rankHi &&
+        (!opt.specialised ||
+         (!(opt.tables && tryTableKernel(labs, finishTimes, C, T, used0, best, ctl, opt.tableMemo)) &&
+          !trySmallKernel(labs, finishTimes, C, T, L, used0, best, ctl))))
+    {
+        vector<int> insp;
+        dfsRecursive(labs, finishTimes, insp,
+                     0, C, T, L,
+                     best, used0, 0,
+                     idx, busy, avail, ctl);
+    }
+    if (stats) {
+        stats->nodes = ctl.nodes;
+        stats->cuts  = move(ctl.bestCuts);
+        stats->status = ctl.status;
+    }
+
+    long long idle = 1LL * T * ins.L - best;
+    return {best, idle};
+}
+
+
+/* standalone LDS: by default rounds continue until one proves optimality
+   (k = C at the latest), so the answer matches solveExact; a smaller maxK
+   returns the best schedule found within k <= maxK, and *complete says
+   whether some round still covered every cut set */
+pair<long long,long long> solveLDS(const Instance& ins, int maxK = -1,
+                                   vector<pair<int,long long>>* trace = nullptr,
+                                   bool* complete = nullptr)
+{
+    const vector<int> finishTimes = ins.presolved ? ins.finishTimes
+                                                  : buildFinishTimes(ins);
+    long long used0 = ins.fixedUsage;
+    int L = 0;
+    for (const Lab& lab : ins.labs) {
+        used0 += 1LL * lab.mult * (lab.p.empty() ? 0 : lab.p[0]);
+        L     += lab.mult;
+    }
+    long long best = runLDS(ins.labs, finishTimes, ins.C, ins.T, L, used0, used0,
+                            maxK < 0 ? ins.C : min(maxK, ins.C), LLONG_MAX, complete, trace);
+    return {best, 1LL * ins.T * ins.L - best};
+}
+
+
+/* ---------- Incremental re-solve ----------
+   Keeps an instance as parsed together with what its last solve learned:
+   the optimum, a cut set reaching it and the TableKernel tables.  After an
+   edit the old cuts, repaired to the new candidates, are the starting
+   incumbent, and tables of untouched labs are reused.  A shorter day can
+   only lower the optimum, so after such edits the old optimum is also a
+   ceiling that ends the search as soon as it is met.  Changing C gives no
+   such bound: an extra inspection restarts idle labs and keeps one more
+   student after pruning, so it can raise the optimum.                    */
+struct Edit {
+    string op;                        // "student", "T" or "C"
+    int a = 0, b = 0;                 // student: lab (from 1), period; T / C: new value
+};
+
+/* exactly C distinct candidates close to old: the old cuts that are still
+   candidates, then greedily the best cut to drop or add; empty when there
+   are fewer than C candidates */
+vector<int> repairCuts(const Instance& ins, const vector<int>& finishTimes,
+                       const vector<int>& old)
+{
+    if ((int)finishTimes.size() < ins.C) return {};
+    vector<int> cuts;
+    for (int c : old)
+        if (binary_search(finishTimes.begin(), finishTimes.end(), c)) cuts.push_back(c);
+
+    vector<CutVector> trials;
+    while ((int)cuts.size() > ins.C) {
+        trials.assign(cuts.size(), cuts);
+        for (size_t k = 0; k < cuts.size(); ++k) trials[k].erase(trials[k].begin() + k);
+        vector<long long> u = evaluateBatch(ins, trials);
+        cuts = trials[max_element(u.begin(), u.end()) - u.begin()];
+    }
+    while ((int)cuts.size() < ins.C) {
+        trials.clear();
+        for (int c : finishTimes) {
+            if (binary_search(cuts.begin(), cuts.end(), c)) continue;
+            trials.push_back(cuts);
+            trials.back().insert(upper_bound(trials.back().begin(), trials.back().end(), c), c);
+        }
+        vector<long long> u = evaluateBatch(ins, trials);
+        cuts = trials[max_element(u.begin(), u.end()) - u.begin()];
+    }
+    return cuts;
+}
+
+struct IncrementalSolver {
+    Instance raw;                     // as parsed; edits apply here
+    SolveOptions opt;
+    bool presolve = true;
+
+    long long best = -1;              // usage of the last solve, -1 before the first
+    vector<int> cuts;                 // cut times reaching it (may be empty)
+    bool ceilingValid = false;        // no edit since then could raise the optimum
+    TableMemo memo;
+    long long counted = 0;            // students left after pruning, last solve
+
+    IncrementalSolver(Instance ins, const SolveOptions& o, bool pre)
+        : raw(move(ins)), opt(o), presolve(pre) {}
+
+    /* false for an unknown op or lab */
+    bool apply(const Edit& e)
+    {
+        if (e.op == "student") {
+            if (e.a < 1 || e.a > (int)raw.labs.size()) return false;
+            raw.labs[e.a - 1].p.push_back(e.b);
+            ceilingValid = false;
+        } else if (e.op == "T") {
+            ceilingValid = ceilingValid && e.a <= raw.T;
+            raw.T = e.a;
+        } else if (e.op == "C") {
+            ceilingValid = false;
+            raw.C = e.a;
+        } else return false;
+        return true;
+    }
+
+    pair<long long,long long> solve(SolveStats* stats = nullptr)
+    {
+        Instance ins = raw;
+        pruneInstance(ins);
+        counted = 0;
+        for (const Lab& lab : ins.labs) counted += lab.p.size();
+        if (presolve) presolveInstance(ins);
+        const vector<int> finishTimes = ins.presolved ? ins.finishTimes
+                                                      : buildFinishTimes(ins);
+
+        SolveOptions o = opt;
+        vector<int> warm = best < 0 ? vector<int>() : repairCuts(ins, finishTimes, cuts);
+        long long warmUsage = warm.empty() ? -1 : evaluateCuts(ins, warm);
+        o.incumbent = max(o.incumbent, warmUsage);
+        if (ceilingValid) o.ceiling = min(o.ceiling, best);
+        o.tableMemo = &memo;
+
+        SolveStats st;
+        auto result = solveExact(ins, o, &st);
+        best = result.first;
+        if (!st.cuts.empty())          cuts = st.cuts;
+        else if (warmUsage == best)    cuts = warm;
+        else                           cuts.clear();   // only first students, or seeded elsewhere
+        ceilingValid = st.status == SolveStatus::Optimal;   // a stopped search proves nothing
+        if (stats) *stats = move(st);
+        return result;
+    }
+};
+
+/* edits file: "instance_id,student,lab,period", "instance_id,T,value" or
+   "instance_id,C,value", applied in file order */
+bool readEdits(const string& path, map<string, vector<Edit>>& out)
+{
+    ifstream in(path);
+    if (!in) return false;
+    string line;
+    while (getline(in, line)) {
+        auto f = splitCSV(line);
+        if (f.size() < 3 || f[0].empty()) continue;
+        Edit e{f[1], stoi(f[2]), f.size() > 3 ? stoi(f[3]) : 0};
+        if (e.op == "student" && f.size() < 4) return false;
+        out[f[0]].push_back(e);
+    }
+    return true;
+}
+
+
+/* ---------- Portfolio ----------
+   solveExact on the calling thread races cheap heuristics on their own
+   threads.  All engines share one incumbent; the search stops as soon as it
+   proves optimality (or a heuristic reaches its ceiling), and the deadline,
+   if any, stops everything and returns the best schedule found so far.   */
+struct PortfolioResult {
+    long long best = 0, idle = 0;
+    SolveStatus status = SolveStatus::Optimal;   // TimedOut: deadline hit before a proof
+    string winner;                    // engine that first reached best
+    double ms = 0;
+};
+
+/* each target snapped to the nearest candidate not yet taken, in order */
+vector<int> snapToCandidates(const vector<int>& finishTimes, const vector<int>& targets)
+{
+    vector<int> cuts;
+    vector<char> used(finishTimes.size(), 0);
+    for (int target : targets) {
+        if (cuts.size() == finishTimes.size()) break;
+        int pick = -1;
+        for (int id = 0; id < (int)finishTimes.size(); ++id)
+            if (!used[id] && (pick < 0 || abs(finishTimes[id] - target) < abs(finishTimes[pick] - target)))
+                pick = id;
+        used[pick] = 1;
+        cuts.push_back(finishTimes[pick]);
+    }
+    sort(cuts.begin(), cuts.end());
+    return cuts;
+}
+
+/* a cheap even-spacing heuristic: the C cuts aim at T*k/(C+1), k = 1..C,
+   so they split the day into C+1 equal blocks (the first block needs no
+   cut).  Not the Approximation program's calendar; see blackboxCuts */
+vector<int> evenlySpacedCuts(const vector<int>& finishTimes, int C, int T)
+{
+    vector<int> targets;
+    for (int k = 1; k <= C; ++k) targets.push_back((int)(1LL * T * k / (C + 1)));
+    return snapToCandidates(finishTimes, targets);
+}
+
+/* the Approximation program's own calendar, inspections at c*(T/C) for
+   c = 0..C-1.  Its cut at 0 is wasted in this model (the first student
+   needs none), which is why evenlySpacedCuts spaces C+1 blocks instead;
+   both are raced, so the exact search starts from whichever is better */
+vector<int> blackboxCuts(const vector<int>& finishTimes, int C, int T)
+{
+    vector<int> targets;
+    for (int c = 0; c < C; ++c) targets.push_back(c * (T / C));
+    return snapToCandidates(finishTimes, targets);
+}
+
+PortfolioResult solvePortfolio(const Instance& ins, SolveOptions opt, double deadlineMs = 0)
+{
+    using clk = chrono::steady_clock;
+    const auto t0 = clk::now();
+    const vector<int> finishTimes = ins.presolved ? ins.finishTimes : buildFinishTimes(ins);
+    const int C = ins.C, T = ins.T;
+    long long used0 = ins.fixedUsage;
+    int L = 0;
+    for (const Lab& lab : ins.labs) {
+        used0 += 1LL * lab.mult * (lab.p.empty() ? 0 : lab.p[0]);
+        L     += lab.mult;
+    }
+
+    CancelToken stop;
+    atomic<bool> proven{false};
+    atomic<long long> shared{max(used0, opt.incumbent)};
+    mutex m;
+    condition_variable finished;
+    PortfolioResult r;
+    r.winner = "first-students";
+    auto offer = [&](long long u, const char* who) {
+        lock_guard<mutex> g(m);
+        long long s = shared.load();
+        while (s < u && !shared.compare_exchange_weak(s, u)) {}
+        if (u > r.best) r.best = u, r.winner = who;
+    };
+    offer(shared.load(), "first-students");
+    auto prove = [&] {
+        { lock_guard<mutex> g(m); proven = true; }
+        stop.cancel();
+        finished.notify_all();
+    };
+
+    vector<thread> workers;
+    if ((int)finishTimes.size() >= C) {
+        workers.emplace_back([&] {
+            offer(evaluateCuts(ins, evenlySpacedCuts(finishTimes, C, T)), "even");
+            offer(evaluateCuts(ins, blackboxCuts(finishTimes, C, T)), "blackbox");
+        });
+        workers.emplace_back([&] {
+            bool complete = false;
+            /* low k is where LDS is quick to a good incumbent (and often to a
+               proof); deeper rounds would only redo the exact search */
+            long long b = runLDS(ins.labs, finishTimes, C, T, L, used0, shared.load(),
+                                 min(C, 2), LLONG_MAX, &complete, nullptr, &stop);
+            offer(b, "lds");
+            if (complete) prove();      // every cut set seen: LDS has the optimum
+        });
+        workers.emplace_back([&] {
+            auto binom = binomialTable(finishTimes.size(), C);
+            unsigned long long N = binom[finishTimes.size()][C];
+            mt19937_64 rng(opt.seed);
+            vector<CutVector> batch(256);
+            for (int round = 0; round < 64 && N < ULLONG_MAX && !stop.cancelled(); ++round) {
+                for (CutVector& cuts : batch) {
+                    cuts.clear();
+                    for (int id : unrankSubset(binom, finishTimes.size(), C, rng() % N))
+                        cuts.push_back(finishTimes[id]);
+                }
+                for (long long u : evaluateBatch(ins, batch)) offer(u, "sample");
+            }
+        });
+    }
+    thread watchdog;
+    if (deadlineMs > 0)
+        watchdog = thread([&] {
+            unique_lock<mutex> g(m);
+            if (!finished.wait_for(g, chrono::duration<double, milli>(deadlineMs),
+                                   [&] { return proven.load(); }))
+                stop.cancel();
+        });
+
+    opt.cancel = &stop;
+    opt.shared = &shared;
+    opt.incumbent = shared.load();
+    SolveStats st;
+    long long exact = solveExact(ins, opt, &st).first;
+    {
+        lock_guard<mutex> g(m);
+        if (exact > r.best) r.best = exact, r.winner = "exact";
+    }
+    if (st.status == SolveStatus::Optimal) prove();   // the search ran to the end
+    stop.cancel();                    // heuristics still running are not needed
+    finished.notify_all();
+    for (thread& w : workers) w.join();
+    if (watchdog.joinable()) watchdog.join();
+
+    r.best = max(r.best, shared.load());
+    r.idle = 1LL * T * ins.L - r.best;
+    r.status = proven ? SolveStatus::Optimal : SolveStatus::TimedOut;
+    r.ms = chrono::duration<double, milli>(clk::now() - t0).count();
+    return r;
+}
+
+
+/* ---------- Hardness model ----------
+   Predicts log2 of the search nodes solveExact will need from features that
+   cost O(total students) to compute; nodes rather than time, so the target
+   does not depend on the machine.  The default coefficients are a least
+   squares fit on 500_tight_instances.csv (--calibrate refits and reports);
+   --route sends instances predicted above a node budget to bounded LDS.  */
+const vector<string> hardnessFeatureNames = {
+    "bias", "log2_subsets", "candidates", "C", "log2_labs", "log2_T",
+    "students_mean", "students_sd", "slack"
+};
+
+/* on the instance as solveExact sees it (pruned, presolved) */
+vector<double> hardnessFeatures(const Instance& ins)
+{
+    const vector<int> finishTimes = ins.presolved ? ins.finishTimes : buildFinishTimes(ins);
+    const int K = finishTimes.size(), C = ins.C;
+    double subsets = 0;               // log2 (K choose C)
+    for (int k = 0; k < C && K >= C; ++k) subsets += log2((double)(K - k) / (k + 1));
+
+    double labs = 0, students = 0, sq = 0, work = 0;
+    for (const Lab& lab : ins.labs) {
+        double n = lab.p.size();
+        labs     += lab.mult;
+        students += lab.mult * n;
+        sq       += lab.mult * n * n;
+        work     += 1.0 * lab.mult * accumulate(lab.p.begin(), lab.p.end(), 0LL);
+    }
+    double mean = labs > 0 ? students / labs : 0;
+    double sd   = labs > 0 ? sqrt(max(0.0, sq / labs - mean * mean)) : 0;
+    double slack = labs > 0 ? 1 - work / (labs * ins.T) : 1;
+    return {1, subsets, (double)K, (double)C, log2(1 + labs), log2(1.0 + ins.T),
+            mean, sd, slack};
+}
+
+struct HardnessModel {
+    vector<double> w;                 // one per feature
+
+    double predictLog2(const vector<double>& x) const
+    {
+        double y = 0;
+        for (size_t k = 0; k < w.size(); ++k) y += w[k] * x[k];
+        return y;
+    }
+    double predictNodes(const vector<double>& x) const { return exp2(predictLog2(x)); }
+};
+
+/* calibrated on 500_tight_instances.csv with --calibrate */
+const HardnessModel& defaultHardnessModel()
+{
+    static const HardnessModel m{{
+        1.14225, 0.25339, 0.0260895, 0.29843, 0.208455, -0.0458893,
+        0.232642, 0.0384929, -0.589268
+    }};
+    return m;
+}
+
+/* ridge-regularised least squares: (X'X + lambda I) w = X'y */
+HardnessModel fitHardnessModel(const vector<vector<double>>& X, const vector<double>& y,
+                               double lambda = 1e-6)
+{
+    const int d = hardnessFeatureNames.size();
+    vector<vector<double>> A(d, vector<double>(d + 1, 0));
+    for (size_t r = 0; r < X.size(); ++r)
+        for (int i = 0; i < d; ++i) {
+            for (int j = 0; j < d; ++j) A[i][j] += X[r][i] * X[r][j];
+            A[i][d] += X[r][i] * y[r];
+        }
+    for (int i = 0; i < d; ++i) A[i][i] += lambda;
+    for (int c = 0; c < d; ++c) {    // Gauss-Jordan, partial pivoting
+        int piv = c;
+        for (int r = c + 1; r < d; ++r) if (fabs(A[r][c]) > fabs(A[piv][c])) piv = r;
+        swap(A[c], A[piv]);
+        if (fabs(A[c][c]) < 1e-12) continue;   // constant feature on this data
+        for (int r = 0; r < d; ++r) {
+            if (r == c) continue;
+            double f = A[r][c] / A[c][c];
+            for (int k = c; k <= d; ++k) A[r][k] -= f * A[c][k];
+        }
+    }
+    HardnessModel m;
+    for (int i = 0; i < d; ++i) m.w.push_back(fabs(A[i][i]) < 1e-12 ? 0 : A[i][d] / A[i][i]);
+    return m;
+}
+
+/* accuracy of a model on (features, log2 nodes) pairs: R^2, mean absolute
+   error in log2 units, Spearman rank correlation and the confusion matrix
+   of "more than budget nodes" (budget 0: the median, so "harder half") */
+void hardnessReport(const string& name, const HardnessModel& m,
+                    const vector<vector<double>>& X, const vector<double>& y, double budget)
+{
+    const size_t n = y.size();
+    vector<double> pred(n);
+    double mean = 0, ssRes = 0, ssTot = 0, mae = 0;
+    for (size_t r = 0; r < n; ++r) pred[r] = m.predictLog2(X[r]), mean += y[r] / n;
+    for (size_t r = 0; r < n; ++r) {
+        ssRes += (y[r] - pred[r]) * (y[r] - pred[r]);
+        ssTot += (y[r] - mean) * (y[r] - mean);
+        mae   += fabs(y[r] - pred[r]) / n;
+    }
+    auto ranks = [&](const vector<double>& v) {
+        vector<size_t> order(n);
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&](size_t a, size_t b) { return v[a] < v[b]; });
+        vector<double> rk(n);
+        for (size_t i = 0; i < n;) {  // ties share their mean rank
+            size_t j = i;
+            while (j < n && v[order[j]] == v[order[i]]) ++j;
+            for (size_t k = i; k < j; ++k) rk[order[k]] = (i + j - 1) / 2.0;
+            i = j;
+        }
+        return rk;
+    };
+    vector<double> ry = ranks(y), rp = ranks(pred);
+    double my = 0, mp = 0, sxy = 0, sxx = 0, syy = 0;
+    for (size_t r = 0; r < n; ++r) my += ry[r] / n, mp += rp[r] / n;
+    for (size_t r = 0; r < n; ++r) {
+        sxy += (ry[r] - my) * (rp[r] - mp);
+        sxx += (ry[r] - my) * (ry[r] - my);
+        syy += (rp[r] - mp) * (rp[r] - mp);
+    }
+    int conf[2][2] = {};              // [actually hard][predicted hard]
+    vector<double> sorted = y;
+    nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+    double cut = budget > 0 ? log2(budget) : sorted[n / 2];
+    for (size_t r = 0; r < n; ++r) conf[y[r] > cut][pred[r] > cut]++;
+
+    cout << fixed << setprecision(3)
+         << name << ": n=" << n
+         << "  R2=" << (ssTot > 0 ? 1 - ssRes / ssTot : 0.0)
+         << "  MAE(log2 nodes)=" << mae
+         << "  spearman=" << (sxx > 0 && syy > 0 ? sxy / sqrt(sxx * syy) : 0.0) << "\n"
+         << "  " << (budget > 0 ? "budget " : "median ") << defaultfloat << exp2(cut) << " nodes:"
+         << "  easy->easy " << conf[0][0] << "  easy->hard " << conf[0][1]
+         << "  hard->easy " << conf[1][0] << "  hard->hard " << conf[1][1] << "\n";
+}
+
+
+/* ---------- Packed lab state ----------
+   Per lab the search needs idx and ready = max(busy, avail).  ready is
+   always 0, the lab's first period or one of the candidate cuts, so it is
+   stored as an index into the sorted table of those times.  A lab takes
+   idxBits + timeBits bits and labs never straddle a 64-bit word, so whole
+   states copy, compare and hash as a handful of words.
+   solveExactDP is the only consumer: it is the engine that stores and
+   dedups states.  dfsRecursive and the SmallKernels keep their per-lab
+   state unpacked, since they simulate from it directly and copy it once
+   per child rather than holding it in a table.                            */
+struct StateCodec {
+    vector<int> times;       // every value ready can take, sorted
+    vector<int> cutTime;     // finishTimes[id] -> index into times
+    int idxBits = 1, timeBits = 1, perWord = 64, words = 0;
+
+    StateCodec(const vector<Lab>& labs, const vector<int>& finishTimes)
+    {
+        times = finishTimes;
+        times.push_back(0);
+        size_t maxIdx = 1;
+        for (const Lab& lab : labs) {
+            times.push_back(lab.p.empty() ? 0 : lab.p[0]);
+            maxIdx = max(maxIdx, lab.p.size());
+        }
+        sort(times.begin(), times.end());
+        times.erase(unique(times.begin(), times.end()), times.end());
+        for (int t : finishTimes) cutTime.push_back(timeId(t));
+
+        idxBits  = max(1, (int)bit_width(maxIdx));
+        timeBits = max(1, (int)bit_width(times.size() - 1));
+        perWord  = 64 / (idxBits + timeBits);
+        words    = ((int)labs.size() + perWord - 1) / perWord;
+    }
+
+    int timeId(int t) const {
+        return lower_bound(times.begin(), times.end(), t) - times.begin();
+    }
+    uint64_t field(const uint64_t* s, int lab) const {
+        int shift = (lab % perWord) * (idxBits + timeBits);
+        return (s[lab / perWord] >> shift) & ((1ULL << (idxBits + timeBits)) - 1);
+    }
+    int idx(const uint64_t* s, int lab) const {
+        return field(s, lab) & ((1ULL << idxBits) - 1);
+    }
+    int readyId(const uint64_t* s, int lab) const {
+        return field(s, lab) >> idxBits;
+    }
+    void set(uint64_t* s, int lab, int idx, int readyId) const {
+        int shift = (lab % perWord) * (idxBits + timeBits);
+        uint64_t mask = ((1ULL << (idxBits + timeBits)) - 1) << shift;
+        uint64_t v = ((uint64_t)readyId << idxBits) | (uint64_t)idx;
+        s[lab / perWord] = (s[lab / perWord] & ~mask) | (v << shift);
+    }
+};
+
+/* flat set of fixed-width packed states, keeping the best usedSoFar of each */
+struct StateTable {
+    int W;                        // words per state
+    vector<uint64_t> keys;        // size() * W words
+    vector<long long> used;
+    vector<int> slots;            // open addressing into used[], -1 = empty
+
+    explicit StateTable(int w) : W(w), slots(16, -1) {}
+
+    size_t size() const { return used.size(); }
+    const uint64_t* key(size_t k) const { return keys.data() + k * W; }
+
+    void clear() {
+        keys.clear();
+        used.clear();
+        fill(slots.begin(), slots.end(), -1);
+    }
+
+    static uint64_t mix(uint64_t h) {           // splitmix64 finaliser
+        h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+    size_t slotOf(const uint64_t* s) const {
+        uint64_t h = 0;
+        for (int w = 0; w < W; ++w) h = mix(h + s[w]);
+        size_t mask = slots.size() - 1, i = h & mask;
+        while (slots[i] >= 0 && !equal(s, s + W, key(slots[i]))) i = (i + 1) & mask;
+        return i;
+    }
+
+    void insert(const uint64_t* s, long long u) {
+        size_t i = slotOf(s);
+        if (slots[i] >= 0) {
+            used[slots[i]] = max(used[slots[i]], u);
+            return;
+        }
+        slots[i] = used.size();
+        keys.insert(keys.end(), s, s + W);
+        used.push_back(u);
+        if (used.size() * 2 > slots.size()) {   // keep load factor <= 1/2
+            slots.assign(slots.size() * 2, -1);
+            for (size_t k = 0; k < used.size(); ++k) slots[slotOf(key(k))] = k;
+        }
+    }
+};
+
+
+/* ---------- Layered DP: breadth-wise alternative to dfsRecursive ----------
+   Layer k holds every distinct state reachable with k cuts.  A lab's future
+   depends only on idx and ready = max(busy, avail), so states are packed as
+   (next candidate id, idx[], ready[]) and merged keeping the max usedSoFar. */
+
+/* frontier (optional) receives the layer sizes for depth 0..C-1, then the
+   number of complete cut sets evaluated at depth C */
+pair<long long,long long> solveExactDP(const Instance& ins,
+                                       vector<size_t>* frontier = nullptr)
+{
+    int C = ins.C, T = ins.T;
+    const auto& labs = ins.labs;
+    int n = labs.size();
+    const vector<int> finishTimes = ins.presolved ? ins.finishTimes
+                                                  : buildFinishTimes(ins);
+    int K = finishTimes.size();
+    const StateCodec codec(labs, finishTimes);
+    const int W = 1 + codec.words;    // word 0 = next candidate id
+
+    vector<uint64_t> root(W, 0);
+    long long used0 = ins.fixedUsage;
+    int L = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        int p0 = labs[i].p.empty() ? 0 : labs[i].p[0];
+        codec.set(root.data() + 1, i, 1, codec.timeId(p0));   // first student running
+        used0 += 1LL * labs[i].mult * p0;
+        L     += labs[i].mult;
+    }
+
+    /* final block [last cut, T) */
+    auto finish = [&](const uint64_t* s, long long used) {
+        for (int i = 0; i < n; ++i) {
+            int idx = codec.idx(s + 1, i), ready = codec.times[codec.readyId(s + 1, i)];
+            used += advanceLab(labs[i], idx, ready, T);
+        }
+        return used;
+    };
+
+    long long best = used0;
+    if (C == 0) {
+        best = finish(root.data(), used0);
+        return {best, 1LL * T * ins.L - best};
+    }
+
+    StateTable layer(W), next(W);
+    layer.insert(root.data(), used0);
+    vector<uint64_t> s2(W);
+    size_t leaves = 0;
+    for (int depth = 0; depth < C && layer.size() > 0; ++depth)
+    {
+        if (frontier) frontier->push_back(layer.size());
+        next.clear();
+        for (size_t k = 0; k < layer.size(); ++k)
+        {
+            const uint64_t* s = layer.key(k);
+            long long used = layer.used[k];
+            int first = s[0];
+            int lastCut = first == 0 ? 0 : finishTimes[first - 1];
+            if (used + 1LL * (T - lastCut) * L <= best) continue;
+
+            for (int id = first; id < K; ++id)
+            {
+                int cut = finishTimes[id];
+                copy(s, s + W, s2.begin());
+                s2[0] = id + 1;
+                long long used2 = used;
+                for (int i = 0; i < n; ++i)
+                {
+                    int idx = codec.idx(s + 1, i), rid = codec.readyId(s + 1, i);
+                    int ready = codec.times[rid];
+                    used2 += advanceLab(labs[i], idx, ready, cut);
+                    codec.set(s2.data() + 1, i, idx, ready == cut ? codec.cutTime[id] : rid);
+                }
+
+                if (depth + 1 == C) {           // complete cut set
+                    best = max(best, finish(s2.data(), used2));
+                    leaves++;
+                    continue;
+                }
+                if (used2 + 1LL * (T - cut) * L <= best) continue;
+                next.insert(s2.data(), used2);
+            }
+        }
+        swap(layer, next);
+    }
+    if (frontier) frontier->push_back(leaves);
+
+    return {best, 1LL * T * ins.L - best};
+}
+
+
+/* ---------- Shard result files ---------- */
+/* instance_id -> best_usage from any output file of this program */
+bool readIncumbents(const string& path, map<string,long long>& out)
+{
+    ifstream in(path);
+    if (!in) return false;
+    string line;
+    getline(in, line);
+    auto head = splitCSV(line);
+    auto col = find(head.begin(), head.end(), "best_usage") - head.begin();
+    if (head.empty() || head[0] != "instance_id" || col == (long)head.size()) return false;
+    while (getline(in, line)) {
+        auto row = splitCSV(line);
+        if ((long)row.size() <= col) continue;
+        long long v = stoll(row[col]);
+        auto [it, fresh] = out.emplace(row[0], v);
+        if (!fresh) it->second = max(it->second, v);
+    }
+    return true;
+}
+
+/* combine shard outputs row by row: best_usage is the max over shards,
+   idle_time follows from it, nodes are summed, lp_bound is the min */
+int mergeShards(const vector<string>& inputs, const string& outputfile)
+{
+    vector<string> header, order;
+    map<string, vector<string>> rows;
+    long long nodes = 0;
+    for (const string& path : inputs) {
+        ifstream in(path);
+        if (!in) { cerr << "Cannot open " << path << "\n"; return 1; }
+        string line;
+        getline(in, line);
+        auto head = splitCSV(line);
+        if (header.empty()) header = head;
+        else if (head != header) { cerr << "Header mismatch in " << path << "\n"; return 1; }
+
+        auto colOf = [&](const char* name) {
+            return (int)(find(header.begin(), header.end(), name) - header.begin());
+        };
+        int cBest = colOf("best_usage"), cIdle = colOf("idle_time");
+        int cNodes = colOf("nodes"), cLp = colOf("lp_bound");
+        while (getline(in, line)) {
+            auto row = splitCSV(line);
+            if (row.size() != header.size()) continue;
+            if (cNodes < (int)row.size()) nodes += stoll(row[cNodes]);
+            auto it = rows.find(row[0]);
+            if (it == rows.end()) { order.push_back(row[0]); rows.emplace(row[0], row); continue; }
+
+            auto& m = it->second;
+            long long total = stoll(m[cBest]) + stoll(m[cIdle]);   // T * L
+            long long best  = max(stoll(m[cBest]), stoll(row[cBest]));
+            m[cBest] = to_string(best);
+            m[cIdle] = to_string(total - best);
+            if (cNodes < (int)row.size())
+                m[cNodes] = to_string(stoll(m[cNodes]) + stoll(row[cNodes]));
+            if (cLp < (int)row.size())
+                m[cLp] = to_string(min(stoll(m[cLp]), stoll(row[cLp])));
+        }
+    }
+
+    ofstream out(outputfile);
+    if (!out) { cerr << "Cannot open output file\n"; return 1; }
+    for (size_t k = 0; k < header.size(); ++k) out << (k ? "," : "") << header[k];
+    out << "\n";
+    for (const string& id : order) {
+        const auto& row = rows[id];
+        for (size_t k = 0; k < row.size(); ++k) out << (k ? "," : "") << row[k];
+        out << "\n";
+    }
+    cout << "Merged " << inputs.size() << " shards (" << nodes << " nodes).  Wrote "
+         << outputfile << "\n";
+    return 0;
+}
+
+
+/* ---------- Checkpoints ----------
+   Text file rewritten atomically (tmp + rename): the output rows of the
+   finished instances, then the instance in progress as
+   active,<id>,<first unsettled rank>,<incumbent>,<nodes>.               */
+struct Checkpoint {
+    string path;
+    double every = 60;                // seconds between writes
+    chrono::steady_clock::time_point last = chrono::steady_clock::now();
+    vector<string> rows;              // finished output rows, in order
+    string activeId;
+    unsigned long long rank = 0;
+    long long best = -1, nodes = 0;
+
+    bool load() {
+        ifstream in(path);
+        if (!in) return false;
+        string line;
+        while (getline(in, line)) {
+            if (line.rfind("row,", 0) == 0) rows.push_back(line.substr(4));
+            else if (line.rfind("active,", 0) == 0) {
+                auto f = splitCSV(line);
+                if (f.size() != 5) return false;
+                activeId = f[1];
+                rank  = stoull(f[2]);
+                best  = stoll(f[3]);
+                nodes = stoll(f[4]);
+            }
+        }
+        return true;
+    }
+
+    void save() {
+        string tmp = path + ".tmp";
+        {
+            ofstream out(tmp);
+            out << "# checkpoint: finished rows, then the instance in progress\n";
+            for (const string& r : rows) out << "row," << r << "\n";
+            if (!activeId.empty())
+                out << "active," << activeId << ',' << rank << ',' << best << ',' << nodes << "\n";
+        }
+        rename(tmp.c_str(), path.c_str());
+        last = chrono::steady_clock::now();
+    }
+
+    void maybeSave() {
+        if (chrono::duration<double>(chrono::steady_clock::now() - last).count() >= every) save();
+    }
+};
+
+
+/* ---------- Cut-set evaluation benchmark ---------- */
+/* scores n random C-subsets of finishTimes per instance with evaluateBatch
+   and evaluateCuts, checks they agree and prints cut sets per second */
+int benchEvaluate(const vector<Instance>& instances, int n, unsigned long long seed)
+{
+    using clk = chrono::steady_clock;
+    mt19937_64 rng(seed);
+    double tBatch = 0, tScalar = 0;
+    long long sets = 0;
+    for (const Instance& ins : instances) {
+        vector<int> ft = ins.presolved ? ins.finishTimes : buildFinishTimes(ins);
+        if ((int)ft.size() < ins.C) continue;
+        vector<CutVector> batch(n);
+        for (CutVector& c : batch) {
+            vector<int> pool = ft;
+            shuffle(pool.begin(), pool.end(), rng);
+            c.assign(pool.begin(), pool.begin() + ins.C);
+            sort(c.begin(), c.end());
+        }
+
+        auto t0 = clk::now();
+        vector<long long> got = evaluateBatch(ins, batch);
+        auto t1 = clk::now();
+        for (int b = 0; b < n; ++b)
+            if (evaluateCuts(ins, batch[b]) != got[b]) {
+                cerr << "evaluateBatch mismatch on " << ins.id << "\n";
+                return 1;
+            }
+        auto t2 = clk::now();
+        tBatch  += chrono::duration<double>(t1 - t0).count();
+        tScalar += chrono::duration<double>(t2 - t1).count();
+        sets += n;
+    }
+    cout << fixed << setprecision(0)
+         << "Evaluated " << sets << " cut sets: batch " << sets / tBatch
+         << " sets/s, scalar " << sets / tScalar << " sets/s\n";
+    return 0;
+}
+
+
+/* ---------- MAIN ---------- */
+int main(int argc, char* argv[]) {
+    string inputfile = "500_tight_instances.csv";
+    string outputfile = "500_tight_instancesOutputOptimal.csv";
+    bool presolve = true;
+    bool stats    = false;            // per-instance engine statistics to stdout
+    SolveOptions opt;
+    string engine = "dfs";            // dfs | dp | lds | portfolio
+    double deadlineMs = 0;            // portfolio: answer by then, proven or not
+    string incumbentFile;
+    bool merge = false;               // combine shard outputs instead of solving
+    Checkpoint ckpt;                  // ckpt.path empty -> no checkpoints
+    bool resume = false;
+    int benchSets = 0;                // --bench-eval: time cut-set scoring, no solve
+    string editsFile;                 // --edits: re-solve after each edit, incrementally
+    bool calibrate = false;           // fit the hardness model on this input, report accuracy
+    double routeBudget = 0;           // --route: predicted nodes above this go to bounded LDS
+
+    vector<string> files;
+    for (int a = 1; a < argc; ++a) {
+        string arg = argv[a];
+        if (arg == "--no-presolve") presolve = false;
+        else if (arg == "--stats") stats = true;
+        else if (arg == "--generic") opt.specialised = false;
+        else if (arg == "--no-tables") opt.tables = false;
+        else if (arg.rfind("--threads=", 0) == 0) opt.threads = stoi(arg.substr(10));
+        else if (arg.rfind("--lp-depth=", 0) == 0) opt.lpDepth = stoi(arg.substr(11));
+        else if (arg.rfind("--engine=", 0) == 0) engine = arg.substr(9);
+        else if (arg.rfind("--deadline=", 0) == 0) deadlineMs = stod(arg.substr(11));
+        else if (arg.rfind("--time-limit=", 0) == 0) opt.timeLimit = stod(arg.substr(13));
+        else if (arg.rfind("--shard=", 0) == 0) {
+            if (sscanf(arg.c_str() + 8, "%d/%d", &opt.shard, &opt.shards) != 2 ||
+                opt.shards < 1 || opt.shard < 0 || opt.shard >= opt.shards)
+            { cerr << "Bad shard " << arg << " (want k/n, 0 <= k < n)\n"; return 1; }
+        }
+        else if (arg.rfind("--incumbent=", 0) == 0) incumbentFile = arg.substr(12);
+        else if (arg.rfind("--seed=", 0) == 0) {
+            opt.seed = stoull(arg.substr(7));
+            if (opt.samples == 0) opt.samples = 64;
+        }
+        else if (arg.rfind("--samples=", 0) == 0) opt.samples = stoi(arg.substr(10));
+        else if (arg.rfind("--lds=", 0) == 0) opt.ldsRounds = stoi(arg.substr(6));
+        else if (arg == "--merge") merge = true;
+        else if (arg.rfind("--checkpoint=", 0) == 0) ckpt.path = arg.substr(13);
+        else if (arg.rfind("--checkpoint-every=", 0) == 0) ckpt.every = stod(arg.substr(19));
+        else if (arg == "--resume") resume = true;
+        else if (arg.rfind("--bench-eval=", 0) == 0) benchSets = stoi(arg.substr(13));
+        else if (arg.rfind("--edits=", 0) == 0) editsFile = arg.substr(8);
+        else if (arg == "--calibrate") calibrate = true;
+        else if (arg.rfind("--route=", 0) == 0) routeBudget = stod(arg.substr(8));
+        else if (arg.rfind("--", 0) == 0) { cerr << "Unknown option " << arg << "\n"; return 1; }
+        else files.push_back(arg);
+    }
+    if (merge) {
+        if (files.size() < 2) {
+            cerr << "Usage: " << argv[0] << " --merge output_csv shard_csv...\n";
+            return 1;
+        }
+        return mergeShards(vector<string>(files.begin() + 1, files.end()), files[0]);
+    }
+    if (files.size() == 2) { inputfile = files[0]; outputfile = files[1]; }
+    else if (!files.empty()) {
+        cerr << "Usage: " << argv[0] << " [input_csv output_csv]"
+                " [--no-presolve] [--engine=dfs|dp|lds|portfolio [--deadline=ms]] [--generic] [--no-tables] [--threads=N] [--time-limit=S] [--lp-depth=N] [--lds=K] [--stats]"
+                " [--shard=k/n] [--incumbent=csv] [--seed=S] [--samples=N]"
+                " [--checkpoint=file [--checkpoint-every=S] [--resume]] [--bench-eval=N]"
+                " [--edits=csv] [--calibrate | --route=nodes]\n";
+        return 1;
+    }
+    if (engine != "dfs" && engine != "dp" && engine != "lds" && engine != "portfolio") {
+        cerr << "Unknown engine " << engine << "\n";
+        return 1;
+    }
+    if (engine != "dfs" && (opt.shards > 1 || !incumbentFile.empty() || opt.samples > 0 ||
+                           !ckpt.path.empty())) {
+        cerr << "Sharding, incumbents and checkpoints need --engine=dfs\n";
+        return 1;
+    }
+    if (!editsFile.empty() && (engine != "dfs" || opt.shards > 1 || !ckpt.path.empty())) {
+        cerr << "Edits need --engine=dfs and no sharding or checkpoints\n";
+        return 1;
+    }
+    if ((calibrate || routeBudget > 0) && (engine != "dfs" || !editsFile.empty())) {
+        cerr << "Calibration and routing need --engine=dfs and no edits\n";
+        return 1;
+    }
+    if (calibrate && routeBudget > 0) {
+        cerr << "--calibrate solves every instance exactly; drop --route\n";
+        return 1;
+    }
+    if (resume && (ckpt.path.empty() || !ckpt.load())) {
+        cerr << "Cannot read checkpoint " << ckpt.path << "\n";
+        return 1;
+    }
+    map<string,string> finished;      // rows restored from the checkpoint
+    for (const string& row : ckpt.rows) finished.emplace(row.substr(0, row.find(',')), row);
+    ckpt.rows.clear();
+    const string resumeId = ckpt.activeId;
+
+    /* read once at start-up: shards never see each other's progress, so the
+       work of a shard depends only on its inputs, not on scheduling */
+    map<string,long long> incumbents;
+    if (!incumbentFile.empty() && !readIncumbents(incumbentFile, incumbents)) {
+        cerr << "Cannot read incumbents from " << incumbentFile << "\n";
+        return 1;
+    }
+    bool sharded = opt.shards > 1;
+    map<string, vector<Edit>> edits;
+    if (!editsFile.empty() && !readEdits(editsFile, edits)) {
+        cerr << "Cannot read edits from " << editsFile << "\n";
+        return 1;
+    }
+
+    ifstream fin(inputfile);
+    ofstream fout(outputfile);
+    if (!fin) { cerr << "Cannot open input file\n"; return 1; }
+    if (!fout){ cerr << "Cannot open output file\n"; return 1; }
+
+    vector<Instance> instances;
+    string line;
+    /* ------------ PARSE ------------ */
+    while (getline(fin, line)) {
+        if (line.empty() || line[0] == '#' || line.find("instance_id") != string::npos) continue;
+        auto head = splitCSV(line);
+        if (head.size() != 4) { cerr << "Bad header line\n"; return 1; }
+        Instance ins;
+        ins.id = head[0];
+        ins.L  = stoi(head[1]);
+        ins.C  = stoi(head[2]);
+        ins.T  = stoi(head[3]);
+
+        ins.labs.clear();
+        for (int i = 0; i < ins.L; ++i) {
+            if (!getline(fin, line)) { cerr << "Unexpected EOF\n"; return 1; }
+            auto row = splitCSV(line);
+            if (row.empty() || row[0] != "lab") { cerr << "Expected 'lab' row\n"; return 1; }
+            int cnt = stoi(row[1]);
+            if ((int)row.size() != cnt + 2) { cerr << "Bad lab row count\n"; return 1; }
+            Lab lab;
+            lab.p.reserve(cnt);
+            for (int k = 0; k < cnt; ++k) lab.p.push_back(stoi(row[2 + k]));
+            ins.labs.push_back(move(lab));
+        }
+        instances.push_back(move(ins));
+    }
+
+    if (benchSets > 0) {
+        for (Instance& ins : instances) {
+            pruneInstance(ins);
+            if (presolve) presolveInstance(ins);
+        }
+        return benchEvaluate(instances, benchSets, opt.seed);
+    }
+
+    /* ------------ PROCESS & OUTPUT ------------ */
+    fout << "instance_id,best_usage,idle_time,labs,counted_students"
+         << (opt.lpDepth >= 0 ? ",lp_bound" : "") << (sharded ? ",nodes" : "")
+         << (engine == "portfolio" || opt.timeLimit > 0 || routeBudget > 0 ? ",status" : "")
+         << (routeBudget > 0 ? ",route" : "") << "\n";
+    const auto& rules = defaultPresolveRules();
+    vector<long long> reducedTotal(rules.size(), 0);
+    vector<vector<double>> hardX;     // --calibrate: features and log2 nodes
+    vector<double> hardY;
+    for (Instance& ins : instances) {
+        if (auto done = finished.find(ins.id); done != finished.end()) {
+            fout << done->second << '\n';
+            ckpt.rows.push_back(done->second);
+            continue;
+        }
+        auto ed = edits.find(ins.id);
+        optional<IncrementalSolver> resolver;
+        optional<Instance> raw;       // edits start from the instance as parsed
+        if (ed != edits.end()) raw = ins;
+        pruneInstance(ins);
+
+        long long counted = 0;
+        for (const Lab& lab : ins.labs) counted += lab.p.size();
+
+        if (presolve) {
+            auto reduced = presolveInstance(ins, rules);
+            for (size_t k = 0; k < rules.size(); ++k) reducedTotal[k] += reduced[k];
+        }
+
+        long long used, idle;
+        SolveStats st;
+        SolveStatus status = SolveStatus::Optimal;
+        bool routed = false;          // sent to the approximate engine by the model
+        if (engine == "dp") {
+            if (opt.lpDepth >= 0)
+                st.lpBound = rootLPBound(ins, ins.presolved ? ins.finishTimes
+                                                            : buildFinishTimes(ins));
+            vector<size_t> frontier;
+            tie(used, idle) = solveExactDP(ins, &frontier);
+            if (stats) {
+                cout << ins.id << " frontier:";
+                for (size_t f : frontier) cout << ' ' << f;
+                cout << "\n";
+            }
+        } else if (engine == "portfolio") {
+            PortfolioResult pr = solvePortfolio(ins, opt, deadlineMs);
+            used = pr.best;
+            idle = pr.idle;
+            status = pr.status;
+            if (stats)
+                cout << ins.id << " portfolio: " << pr.winner << " in " << pr.ms << " ms"
+                     << (pr.status == SolveStatus::Optimal ? "" : ", unproven") << "\n";
+        } else if (engine == "lds") {
+            vector<pair<int,long long>> trace;
+            bool complete = false;
+            tie(used, idle) = solveLDS(ins, opt.ldsRounds, &trace, &complete);
+            if (!complete) status = SolveStatus::Unproven;
+            if (stats) {
+                cout << ins.id << " lds:";
+                for (auto [k, b] : trace) cout << " k" << k << '=' << b;
+                cout << "\n";
+            }
+        } else {
+            auto inc = incumbents.find(ins.id);
+            opt.incumbent = inc == incumbents.end() ? -1 : inc->second;
+            if (!ckpt.path.empty()) {
+                bool resumed = ins.id == resumeId;
+                opt.resumeRank  = resumed ? ckpt.rank  : 0;
+                opt.resumeNodes = resumed ? ckpt.nodes : 0;
+                if (resumed) opt.incumbent = max(opt.incumbent, ckpt.best);
+                ckpt.activeId = ins.id;
+                opt.onCheckpoint = [&](unsigned long long rank, long long best, long long nodes) {
+                    ckpt.rank = rank;
+                    ckpt.best = best;
+                    ckpt.nodes = nodes;
+                    ckpt.maybeSave();
+                };
+            }
+            if (raw) {
+                resolver.emplace(move(*raw), opt, presolve);
+                tie(used, idle) = resolver->solve(&st);
+            } else if (routeBudget > 0 &&
+                       defaultHardnessModel().predictNodes(hardnessFeatures(ins)) > routeBudget) {
+                routed = true;
+                bool complete = false;
+                tie(used, idle) = solveLDS(ins, 1, nullptr, &complete);
+                st.status = complete ? SolveStatus::Optimal : SolveStatus::Unproven;
+            } else
+                tie(used, idle) = solveExact(ins, opt, &st);
+            status = st.status;
+            if (calibrate) {
+                hardX.push_back(hardnessFeatures(ins));
+                hardY.push_back(log2(1.0 + st.nodes));
+            }
+        }
+        ostringstream row;
+        row << ins.id << ',' << used << ',' << idle << ','
+            << ins.L  << ',' << counted;
+        if (opt.lpDepth >= 0) row << ',' << st.lpBound;
+        if (sharded) row << ',' << st.nodes;
+        if (engine == "portfolio" || opt.timeLimit > 0 || routeBudget > 0) row << ',' << statusName(status);
+        if (routeBudget > 0) row << ',' << (routed ? "approx" : "exact");
+        fout << row.str() << '\n';
+
+        if (!ckpt.path.empty()) {
+            ckpt.rows.push_back(row.str());
+            ckpt.activeId.clear();
+            ckpt.maybeSave();
+        }
+
+        /* one row per edit, id+k after the k-th; --stats times each warm
+           re-solve against a cold solveExact of the same edited instance */
+        for (size_t k = 0; resolver && k < ed->second.size(); ++k) {
+            const Edit& e = ed->second[k];
+            if (!resolver->apply(e)) { cerr << "Bad edit " << e.op << " for " << ins.id << "\n"; return 1; }
+            auto t0 = chrono::steady_clock::now();
+            tie(used, idle) = resolver->solve(&st);
+            double warm = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+            fout << ins.id << '+' << k + 1 << ',' << used << ',' << idle << ','
+                 << resolver->raw.L << ',' << resolver->counted;
+            if (opt.lpDepth >= 0) fout << ',' << st.lpBound;
+            if (opt.timeLimit > 0) fout << ',' << statusName(st.status);
+            fout << '\n';
+            if (stats) {
+                Instance cold = resolver->raw;
+                pruneInstance(cold);
+                if (presolve) presolveInstance(cold);
+                t0 = chrono::steady_clock::now();
+                long long coldUsed = solveExact(cold, opt).first;
+                double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+                cout << ins.id << '+' << k + 1 << " warm " << warm << " ms, cold " << ms << " ms"
+                     << (coldUsed == used ? "" : "  MISMATCH") << "\n";
+            }
+        }
+    }
+    if (!ckpt.path.empty()) remove(ckpt.path.c_str());   // run complete
+    if (calibrate && !hardY.empty()) {
+        HardnessModel fit = fitHardnessModel(hardX, hardY);
+        hardnessReport("built-in model", defaultHardnessModel(), hardX, hardY, 0);
+        hardnessReport("refit on " + inputfile, fit, hardX, hardY, 0);
+        cout << "refit coefficients:";
+        for (size_t k = 0; k < fit.w.size(); ++k)
+            cout << ' ' << hardnessFeatureNames[k] << '=' << setprecision(6) << fit.w[k];
+        cout << "\n";
+    }
+    if (presolve) {
+        cout << "Presolve:";
+        for (size_t k = 0; k < rules.size(); ++k)
+            cout << "  " << rules[k].name << " -" << reducedTotal[k];
+        cout << "\n";
     }
     cout << "Done.  Wrote " << outputfile << "\n";
     return 0;